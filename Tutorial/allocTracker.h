@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Heap allocation tracking is off unless ALLOC_TRACKING is defined to 1 on the command line, as 'make bench' does.
+// It replaces the global operator new and delete, so only one translation unit of a program may include it;
+// for the game that is main.cpp, which also gets it through profiler.h. Only C++ allocations are counted, not SDL's.
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 0
+#endif
+
+// Heap allocations made through operator new, and their bytes; frees are not counted
+struct AllocCounts
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    AllocCounts operator-(const AllocCounts &earlier) const
+    {
+        return {allocations - earlier.allocations, bytes - earlier.bytes};
+    }
+
+    AllocCounts &operator+=(const AllocCounts &other)
+    {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        return *this;
+    }
+};
+
+#if ALLOC_TRACKING
+#include <new>
+#include <cstdlib>
+
+/*
+ * Counts every operator new, both per thread (for what a phase on that thread allocated) and over all
+ * threads (for what a whole frame, job threads included, allocated). The counters only ever go up; take a
+ * snapshot before and subtract it afterwards.
+ */
+class AllocTracker
+{
+    inline static std::atomic<uint64_t> totalAllocations{0};
+    inline static std::atomic<uint64_t> totalBytes{0};
+    inline static thread_local AllocCounts thread;
+
+public:
+    static void count(size_t bytes)
+    {
+        totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+        thread.allocations++;
+        thread.bytes += bytes;
+    }
+
+    // Everything allocated so far, on every thread
+    static AllocCounts total()
+    {
+        return {totalAllocations.load(std::memory_order_relaxed), totalBytes.load(std::memory_order_relaxed)};
+    }
+
+    // Everything allocated so far on the calling thread
+    static AllocCounts onThisThread() { return thread; }
+};
+
+namespace allocTracking
+{
+    inline void *allocate(size_t size)
+    {
+        AllocTracker::count(size);
+        if (void *memory = std::malloc(size ? size : 1))
+        {
+            return memory;
+        }
+        throw std::bad_alloc();
+    }
+
+    inline void *allocateAligned(size_t size, std::align_val_t alignment)
+    {
+        AllocTracker::count(size);
+        const size_t align = static_cast<size_t>(alignment);
+        const size_t rounded = (size + align - 1) / align * align; // aligned_alloc wants a multiple of the alignment
+#ifdef _WIN32
+        void *memory = _aligned_malloc(rounded ? rounded : align, align);
+#else
+        void *memory = std::aligned_alloc(align, rounded ? rounded : align);
+#endif
+        if (memory)
+        {
+            return memory;
+        }
+        throw std::bad_alloc();
+    }
+
+    inline void freeAligned(void *memory)
+    {
+#ifdef _WIN32
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+}
+
+// The nothrow and array forms of the standard library forward to these
+void *operator new(size_t size) { return allocTracking::allocate(size); }
+void *operator new[](size_t size) { return allocTracking::allocate(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return allocTracking::allocateAligned(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return allocTracking::allocateAligned(size, alignment); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { allocTracking::freeAligned(memory); }
+void operator delete[](void *memory, std::align_val_t) noexcept { allocTracking::freeAligned(memory); }
+void operator delete(void *memory, size_t, std::align_val_t) noexcept { allocTracking::freeAligned(memory); }
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept { allocTracking::freeAligned(memory); }
+
+#define ALLOC_COUNTS_TOTAL() AllocTracker::total()
+#define ALLOC_COUNTS_THREAD() AllocTracker::onThisThread()
+
+#else
+
+#define ALLOC_COUNTS_TOTAL() AllocCounts()
+#define ALLOC_COUNTS_THREAD() AllocCounts()
+
+#endif
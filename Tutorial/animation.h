@@ -1,24 +1,260 @@
 #pragma once
-#include "timer.h"
+#include <SDL3/SDL.h>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdint>
 
-class Animation
+#include "atlasRegion.h"
+#include "assetPack.h"
+
+const uint16_t NO_CLIP = UINT16_MAX;
+
+struct AnimationFrame
+{
+    SDL_FRect rect; // inside the clip's image until the library is resolved, texture coordinates after
+    float duration;
+    uint32_t event; // assetId() of the event name, 0 for none
+};
+
+// Loaded once and shared by everything playing it
+struct AnimationClip
+{
+    std::string name;
+    std::string image;    // asset name of the sprite sheet
+    TextureHandle texture;                   // set by resolve()
+    uint32_t firstFrame = 0, frameCount = 0; // into the library's frame array
+    bool loop = true;                        // once clips stop on their last frame
+};
+
+// All an instance keeps of its animation: the clip and where the playhead is
+struct AnimationPlayhead
+{
+    uint16_t clip = NO_CLIP;
+    uint8_t frame = 0;
+    bool finished = false;
+    float time = 0; // seconds into the current frame
+
+    // Switches to another clip, restarting only when it actually changes
+    void play(uint16_t id)
+    {
+        if (id != clip)
+        {
+            clip = id;
+            frame = 0;
+            finished = false;
+            time = 0;
+        }
+    }
+};
+
+/*
+ * Every animation clip, read from a text file with one command per line:
+ *   clip <name> <image> <loop|once>
+ *   frames <count> <x> <y> <width> <height> <seconds>  adds frames left to right from x, y in the image
+ *   duration <frame> <seconds>                         changes how long one frame of the clip shows
+ *   event <frame> <name>                               fired whenever the playhead enters the frame
+ * The lines after a clip line describe that clip; '#' starts a comment.
+ */
+class AnimationLibrary
 {
-    Timer timer;
-    int frameCount;
+    std::vector<AnimationClip> clips;
+    std::vector<AnimationFrame> frames; // of every clip, back to back
+
+    static bool fail(const std::string &path, int line, const char *message)
+    {
+        std::cout << path << ":" << line << ": " << message << std::endl;
+        return false;
+    }
 
 public:
-    Animation() : timer(0), frameCount(0) {}
-    Animation(int frameCount, float length) : timer(length), frameCount(frameCount) {}
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            return fail(path, 0, "could not read the file");
+        }
+        clips.clear();
+        frames.clear();
 
-    float getLength() const { return timer.getLength(); }
+        std::string text;
+        for (int line = 1; std::getline(in, text); line++)
+        {
+            std::istringstream fields(text.substr(0, text.find('#')));
+            std::string command;
+            if (!(fields >> command))
+            {
+                continue;
+            }
+            if (command == "clip")
+            {
+                AnimationClip clip;
+                clip.firstFrame = static_cast<uint32_t>(frames.size());
+                std::string mode;
+                if (!(fields >> clip.name >> clip.image >> mode) || (mode != "loop" && mode != "once"))
+                {
+                    return fail(path, line, "expected clip <name> <image> <loop|once>");
+                }
+                if (clips.size() >= NO_CLIP)
+                {
+                    return fail(path, line, "too many clips");
+                }
+                clip.loop = mode == "loop";
+                clips.push_back(clip);
+                continue;
+            }
+            if (clips.empty())
+            {
+                return fail(path, line, "frames, duration and event need a clip line before them");
+            }
 
-    int currentFrame() const
+            AnimationClip &clip = clips.back();
+            if (command == "frames")
+            {
+                int count;
+                float x, y, w, h, seconds;
+                if (!(fields >> count >> x >> y >> w >> h >> seconds) || count <= 0 || seconds <= 0)
+                {
+                    return fail(path, line, "expected frames <count> <x> <y> <width> <height> <seconds>");
+                }
+                if (clip.frameCount + count > UINT8_MAX)
+                {
+                    return fail(path, line, "too many frames in one clip");
+                }
+                for (int i = 0; i < count; i++)
+                {
+                    frames.push_back({SDL_FRect{x + i * w, y, w, h}, seconds, 0});
+                }
+                clip.frameCount += count;
+            }
+            else if (command == "duration" || command == "event")
+            {
+                uint32_t frame;
+                std::string value;
+                if (!(fields >> frame >> value) || frame >= clip.frameCount)
+                {
+                    return fail(path, line, "expected a frame of the clip and a value");
+                }
+                AnimationFrame &f = frames[clip.firstFrame + frame];
+                if (command == "event")
+                {
+                    f.event = assetId(value);
+                }
+                else if ((f.duration = std::strtof(value.c_str(), nullptr)) <= 0)
+                {
+                    return fail(path, line, "durations have to be positive");
+                }
+            }
+            else
+            {
+                return fail(path, line, "unknown command");
+            }
+        }
+        for (const AnimationClip &clip : clips)
+        {
+            if (clip.frameCount == 0)
+            {
+                std::cout << path << ": clip " << clip.name << " has no frames" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const std::vector<AnimationClip> &getClips() const { return clips; }
+
+    /**
+     * @brief Moves every frame rect into its image's atlas region, once the images are loaded.
+     * @param findImage Returns the AtlasRegion of an image by its asset name; a missing image has an invalid texture handle.
+     */
+    template <typename Fn>
+    void resolve(Fn &&findImage)
+    {
+        for (AnimationClip &clip : clips)
+        {
+            const AtlasRegion &image = findImage(clip.image);
+            clip.texture = image.texture;
+            for (uint32_t i = 0; i < clip.frameCount; i++)
+            {
+                frames[clip.firstFrame + i].rect.x += image.rect.x;
+                frames[clip.firstFrame + i].rect.y += image.rect.y;
+            }
+        }
+    }
+
+    // Clip ID by name, NO_CLIP if there is none
+    uint16_t find(std::string_view name) const
+    {
+        for (size_t i = 0; i < clips.size(); i++)
+        {
+            if (clips[i].name == name)
+            {
+                return static_cast<uint16_t>(i);
+            }
+        }
+        return NO_CLIP;
+    }
+
+    TextureHandle getTexture(const AnimationPlayhead &playhead) const
     {
-        return static_cast<int>(timer.getTime() / timer.getLength() * frameCount);
+        return playhead.clip < clips.size() ? clips[playhead.clip].texture : TextureHandle();
+    }
+
+    // The frame under the playhead, null when it plays no clip
+    const AnimationFrame *getFrame(const AnimationPlayhead &playhead) const
+    {
+        return playhead.clip < clips.size() ? &frames[clips[playhead.clip].firstFrame + playhead.frame] : nullptr;
+    }
+
+    /**
+     * @brief Advances a run of playheads, all in one pass.
+     * @param onEvent Called as onEvent(index, event) for every frame event passed, index counting from 'playheads'.
+     */
+    template <typename Fn>
+    void step(AnimationPlayhead *playheads, size_t count, float deltaTime, Fn &&onEvent) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            AnimationPlayhead &p = playheads[i];
+            if (p.clip >= clips.size() || p.finished)
+            {
+                continue;
+            }
+            const AnimationClip &clip = clips[p.clip];
+            const AnimationFrame *clipFrames = &frames[clip.firstFrame];
+
+            p.time += deltaTime;
+            while (p.time >= clipFrames[p.frame].duration)
+            {
+                p.time -= clipFrames[p.frame].duration;
+                if (p.frame + 1u < clip.frameCount)
+                {
+                    p.frame++;
+                }
+                else if (clip.loop)
+                {
+                    p.frame = 0;
+                }
+                else
+                {
+                    p.finished = true;
+                    p.time = 0;
+                    break;
+                }
+                if (clipFrames[p.frame].event)
+                {
+                    onEvent(i, clipFrames[p.frame].event);
+                }
+            }
+        }
     }
 
-    void step(float deltaTime)
+    void step(AnimationPlayhead &playhead, float deltaTime) const
     {
-        timer.step(deltaTime);
+        step(&playhead, 1, deltaTime, [](size_t, uint32_t) {});
     }
 };
\ No newline at end of file
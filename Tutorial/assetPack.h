@@ -0,0 +1,198 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "mappedFile.h"
+#include "atlasRegion.h"
+#include "textureCache.h"
+
+/*
+ * Binary asset pack written by tools/atlasPacker.cpp. Little endian, laid out as:
+ *   PackHeader
+ *   PackPage[pageCount]
+ *   PackEntry[entryCount], sorted by id
+ *   page pixels, RGBA32 rows with no padding, each page starting on a PACK_ALIGNMENT boundary
+ * The pixels are already decoded so the game can hand them from the mapping straight to the GPU.
+ */
+const char PACK_MAGIC[4] = {'A', 'P', 'A', 'K'};
+const uint32_t PACK_VERSION = 1;
+const uint64_t PACK_ALIGNMENT = 16;
+
+struct PackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t pageCount;
+    uint32_t entryCount;
+};
+
+struct PackPage
+{
+    uint32_t width, height;
+    uint64_t offset; // from the start of the file
+};
+
+struct PackEntry
+{
+    uint32_t id;
+    uint16_t page;
+    uint16_t x, y, w, h;
+    uint16_t reserved;
+    char name[44]; // path below Data/ without extension, e.g. "tiles/brick"
+};
+
+static_assert(sizeof(PackHeader) == 16 && sizeof(PackPage) == 16 && sizeof(PackEntry) == 60,
+              "pack structs are written to disk as they are");
+
+// FNV-1a of the asset name, used as its ID both by the packer and in code
+constexpr uint32_t assetId(std::string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : name)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Loads a pack: maps the file, registers every page with the texture cache and keeps the manifest
+ * so assets can be looked up by ID. The mapping stays open, so a page the cache evicted is uploaded
+ * again straight from it.
+ */
+class AssetPack
+{
+    struct Asset
+    {
+        uint32_t id;
+        AtlasRegion region;
+    };
+
+    MappedFile file;
+    const PackPage *pageTable = nullptr;
+    std::vector<TextureHandle> pages;
+    std::vector<Asset> assets; // sorted by id
+
+    SDL_Texture *uploadPage(SDL_Renderer *renderer, uint32_t index) const
+    {
+        const PackPage &page = pageTable[index];
+        SDL_Texture *tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, page.width, page.height);
+        if (!tex || !SDL_UpdateTexture(tex, nullptr, file.data() + page.offset, page.width * 4))
+        {
+            SDL_Log("Could not upload atlas page %u: %s", index, SDL_GetError());
+            SDL_DestroyTexture(tex);
+            return nullptr;
+        }
+        SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+        return tex;
+    }
+
+public:
+    AssetPack() = default;
+    AssetPack(const AssetPack &) = delete; // the cache's loaders point back at the pack
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    /**
+     * @brief Maps a pack and registers its pages; the ones that fit into the cache's budget are uploaded right away.
+     * @param renderer The renderer the pages are uploaded for.
+     * @param cache The cache that owns the page textures.
+     * @param path The pack file.
+     * @return False if the file is missing or not a valid pack.
+     */
+    bool load(SDL_Renderer *renderer, TextureCache &cache, const char *path)
+    {
+        unload(cache);
+
+        if (!file.open(path) || file.size() < sizeof(PackHeader))
+        {
+            file.close();
+            return false;
+        }
+
+        PackHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        const size_t tablesEnd = sizeof(PackHeader) + header.pageCount * sizeof(PackPage) + header.entryCount * sizeof(PackEntry);
+        if (std::memcmp(header.magic, PACK_MAGIC, 4) != 0 || header.version != PACK_VERSION || tablesEnd > file.size())
+        {
+            SDL_Log("%s is not a version %u asset pack", path, PACK_VERSION);
+            file.close();
+            return false;
+        }
+
+        pageTable = reinterpret_cast<const PackPage *>(file.data() + sizeof(PackHeader));
+        for (uint32_t i = 0; i < header.pageCount; i++)
+        {
+            const PackPage &page = pageTable[i];
+            if (page.offset + static_cast<uint64_t>(page.width) * page.height * 4 > file.size())
+            {
+                SDL_Log("%s is truncated", path);
+                unload(cache);
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header.pageCount; i++)
+        {
+            pages.push_back(cache.add([this, i](SDL_Renderer *r)
+                                      { return uploadPage(r, i); }));
+            cache.preload(renderer, pages.back());
+        }
+
+        const PackEntry *entries = reinterpret_cast<const PackEntry *>(pageTable + header.pageCount);
+        assets.reserve(header.entryCount);
+        for (uint32_t i = 0; i < header.entryCount; i++)
+        {
+            const PackEntry &e = entries[i];
+            if (e.page >= pages.size() || e.x + e.w > pageTable[e.page].width || e.y + e.h > pageTable[e.page].height)
+            {
+                SDL_Log("%s: skipping %.*s, it is not inside its page", path, static_cast<int>(sizeof(e.name)), e.name);
+                continue;
+            }
+            assets.push_back({e.id, AtlasRegion{pages[e.page], SDL_FRect{
+                                                                    static_cast<float>(e.x),
+                                                                    static_cast<float>(e.y),
+                                                                    static_cast<float>(e.w),
+                                                                    static_cast<float>(e.h)}}});
+        }
+        std::sort(assets.begin(), assets.end(), [](const Asset &a, const Asset &b)
+                  { return a.id < b.id; });
+
+        // find() could only ever return one of them
+        auto duplicate = std::adjacent_find(assets.begin(), assets.end(), [](const Asset &a, const Asset &b)
+                                            { return a.id == b.id; });
+        if (duplicate != assets.end())
+        {
+            SDL_Log("%s has more than one asset with ID %08x", path, duplicate->id);
+            unload(cache);
+            return false;
+        }
+        return true;
+    }
+
+    // Releases the pages, which destroys their textures; must be called before the cache is cleared
+    void unload(TextureCache &cache)
+    {
+        for (TextureHandle page : pages)
+        {
+            cache.release(page);
+        }
+        pages.clear();
+        assets.clear();
+        pageTable = nullptr;
+        file.close();
+    }
+
+    size_t getPageCount() const { return pages.size(); }
+
+    // Null when the pack has no asset with this ID
+    const AtlasRegion *find(uint32_t id) const
+    {
+        auto it = std::lower_bound(assets.begin(), assets.end(), id, [](const Asset &a, uint32_t v)
+                                   { return a.id < v; });
+        return it != assets.end() && it->id == id ? &it->region : nullptr;
+    }
+};
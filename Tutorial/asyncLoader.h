@@ -0,0 +1,239 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+enum class AssetState
+{
+    queued,
+    decoding,
+    decoded, // images: decoded to a surface, waiting for the main thread to upload it
+    ready,
+    failed
+};
+
+// PCM samples of a sound, in the format the file was stored in
+struct DecodedAudio
+{
+    SDL_AudioSpec spec{};
+    std::vector<uint8_t> pcm;
+};
+
+/*
+ * Decodes assets on worker threads and uploads images on the main thread.
+ * Files are decoded in parallel (IMG_Load to surfaces, SDL_LoadWAV to PCM); the renderer is only
+ * touched from pump(), which uploads decoded surfaces until its per-frame time budget runs out,
+ * so a loading screen keeps rendering while the rest of the files are still being decoded.
+ */
+class AsyncLoader
+{
+public:
+    using Handle = int;
+
+private:
+    enum class Kind
+    {
+        image,
+        audio
+    };
+
+    struct Job
+    {
+        Kind kind;
+        std::string path;
+        std::atomic<AssetState> state{AssetState::queued};
+        SDL_Surface *surface = nullptr;
+        SDL_Texture *texture = nullptr;
+        DecodedAudio audio;
+    };
+
+    std::vector<std::unique_ptr<Job>> jobs;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Handle> pending;  // waiting for a worker
+    std::deque<Handle> decoded;  // images waiting for upload
+    bool stopping = false;
+
+    std::atomic<int> finished{0}; // jobs that are ready or failed
+
+    void work()
+    {
+        while (true)
+        {
+            Handle h;
+            Job *current;
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [this]
+                          { return stopping || !pending.empty(); });
+                if (stopping)
+                {
+                    return;
+                }
+                h = pending.front();
+                pending.pop_front();
+                // taken under the lock: enqueue() may grow 'jobs' meanwhile, the job itself never moves
+                current = jobs[h].get();
+            }
+
+            Job &job = *current;
+            job.state = AssetState::decoding;
+            if (job.kind == Kind::image)
+            {
+                job.surface = IMG_Load(job.path.c_str());
+                if (job.surface)
+                {
+                    job.state = AssetState::decoded;
+                    std::lock_guard lock(mutex);
+                    decoded.push_back(h);
+                    continue;
+                }
+            }
+            else
+            {
+                Uint8 *buffer = nullptr;
+                Uint32 length = 0;
+                if (SDL_LoadWAV(job.path.c_str(), &job.audio.spec, &buffer, &length))
+                {
+                    job.audio.pcm.assign(buffer, buffer + length);
+                    SDL_free(buffer);
+                    job.state = AssetState::ready;
+                    finished++;
+                    continue;
+                }
+            }
+
+            SDL_Log("Could not load %s: %s", job.path.c_str(), SDL_GetError());
+            job.state = AssetState::failed;
+            finished++;
+        }
+    }
+
+    Handle enqueue(Kind kind, const std::string &path)
+    {
+        auto job = std::make_unique<Job>();
+        job->kind = kind;
+        job->path = path;
+
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+        const Handle h = static_cast<Handle>(jobs.size()) - 1;
+        pending.push_back(h);
+        wake.notify_one();
+        return h;
+    }
+
+public:
+    // threadCount 0 uses every core but the one the main thread runs on
+    AsyncLoader(int threadCount = 0)
+    {
+        if (threadCount <= 0)
+        {
+            threadCount = std::max(SDL_GetNumLogicalCPUCores() - 1, 1);
+        }
+        for (int i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back(&AsyncLoader::work, this);
+        }
+    }
+
+    ~AsyncLoader()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &t : workers)
+        {
+            t.join();
+        }
+
+        // anything nobody took ownership of
+        for (auto &job : jobs)
+        {
+            SDL_DestroySurface(job->surface);
+            SDL_DestroyTexture(job->texture);
+        }
+    }
+
+    AsyncLoader(const AsyncLoader &) = delete;
+    AsyncLoader &operator=(const AsyncLoader &) = delete;
+
+    Handle loadImage(const std::string &path) { return enqueue(Kind::image, path); }
+    Handle loadAudio(const std::string &path) { return enqueue(Kind::audio, path); }
+
+    /**
+     * @brief Uploads decoded images to textures until the budget is used up. Main thread only.
+     * @param renderer The renderer the textures are created for.
+     * @param budgetNS How long this call may spend uploading, in nanoseconds. At least one image is uploaded.
+     */
+    void pump(SDL_Renderer *renderer, Uint64 budgetNS)
+    {
+        const Uint64 start = SDL_GetTicksNS();
+        do
+        {
+            Job *current;
+            {
+                std::lock_guard lock(mutex);
+                if (decoded.empty())
+                {
+                    return;
+                }
+                current = jobs[decoded.front()].get();
+                decoded.pop_front();
+            }
+
+            Job &job = *current;
+            job.texture = SDL_CreateTextureFromSurface(renderer, job.surface);
+            SDL_DestroySurface(job.surface);
+            job.surface = nullptr;
+            if (job.texture)
+            {
+                SDL_SetTextureScaleMode(job.texture, SDL_SCALEMODE_NEAREST);
+                job.state = AssetState::ready;
+            }
+            else
+            {
+                SDL_Log("Could not upload %s: %s", job.path.c_str(), SDL_GetError());
+                job.state = AssetState::failed;
+            }
+            finished++;
+        } while (SDL_GetTicksNS() - start < budgetNS);
+    }
+
+    AssetState getState(Handle h) const { return jobs[h]->state; }
+
+    // Fraction of the requested assets that are ready or failed, 1 when nothing was requested
+    float getProgress() const
+    {
+        return jobs.empty() ? 1.0f : static_cast<float>(finished) / jobs.size();
+    }
+
+    bool isDone() const { return finished == static_cast<int>(jobs.size()); }
+
+    // Hands the texture of a ready image over to the caller, who then has to destroy it
+    SDL_Texture *takeTexture(Handle h)
+    {
+        SDL_Texture *tex = jobs[h]->state == AssetState::ready ? jobs[h]->texture : nullptr;
+        jobs[h]->texture = nullptr;
+        return tex;
+    }
+
+    // Moves the samples of a ready sound out of the loader
+    DecodedAudio takeAudio(Handle h)
+    {
+        return jobs[h]->state == AssetState::ready ? std::move(jobs[h]->audio) : DecodedAudio();
+    }
+};
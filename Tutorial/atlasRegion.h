@@ -0,0 +1,11 @@
+#pragma once
+#include <SDL3/SDL.h>
+
+#include "textureCache.h"
+
+// A rectangle on an atlas page (or a whole standalone texture); the texture is resolved through the TextureCache when drawn
+struct AtlasRegion
+{
+    TextureHandle texture;
+    SDL_FRect rect{0, 0, 0, 0};
+};
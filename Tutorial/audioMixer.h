@@ -0,0 +1,369 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "asyncLoader.h"
+
+// Counters for the debug overlay, safe to read from the main thread while audio is playing
+struct AudioStats
+{
+    float latencyMs = 0;    // trigger to output of the most recent sound, device buffer included
+    float maxLatencyMs = 0;
+    int underruns = 0;      // callbacks that came too late or music that ran dry
+    int voicesStolen = 0;
+    int activeVoices = 0;
+};
+
+/*
+ * Sound effects are converted once to the mixer's format and kept in a shared pool; playing one
+ * only claims a voice, and when all MAX_VOICES are busy the voice closest to finishing is taken over.
+ * Voices are mixed in the device callback in small blocks so a sound starts within a few milliseconds.
+ * Music plays through a second stream on the same device that is topped up from disk every frame,
+ * so the track is never decoded into memory as a whole.
+ */
+class AudioMixer
+{
+public:
+    static const int MAX_VOICES = 16;
+    static const int SAMPLE_RATE = 48000;
+    static const int CHANNELS = 2;
+    static const int DEVICE_FRAMES = 256; // requested device buffer, about 5 ms at 48 kHz
+
+private:
+    static const int MIX_FRAMES = 512;         // frames mixed per block in the callback
+    static const int MUSIC_CHUNK = 32 * 1024;  // bytes read from the music file at a time
+    static constexpr float MUSIC_AHEAD = 0.5f; // seconds of music kept queued
+
+    struct Sound
+    {
+        uint32_t id;
+        std::vector<float> samples; // interleaved, in the mixer format
+    };
+
+    struct Voice
+    {
+        int sound = -1; // index into sounds, -1 when free
+        size_t position = 0;
+        float volume = 1;
+        Uint64 triggeredAt = 0; // when play() was called, until the callback first mixes it
+    };
+
+    SDL_AudioSpec spec{SDL_AUDIO_F32, CHANNELS, SAMPLE_RATE};
+    SDL_AudioStream *sfxStream = nullptr;
+    SDL_AudioStream *musicStream = nullptr;
+    Uint64 bufferNS = 0;
+
+    // touched by the callback, only changed with the sfx stream locked
+    std::vector<Sound> sounds;
+    std::array<Voice, MAX_VOICES> voices;
+    std::vector<float> mixBuffer;
+    Uint64 lastCallback = 0;
+
+    std::atomic<int> underruns{0};
+    std::atomic<int> voicesStolen{0};
+    std::atomic<Uint64> latencyNS{0};
+    std::atomic<Uint64> maxLatencyNS{0};
+
+    // music streamed from a WAV file
+    SDL_IOStream *musicFile = nullptr;
+    Sint64 musicDataStart = 0, musicDataSize = 0, musicRead = 0;
+    int musicBytesPerSecond = 0;
+    std::vector<uint8_t> musicChunk;
+    float musicVolume = 0.5f;
+
+    static void SDLCALL feed(void *userdata, SDL_AudioStream *stream, int additional, int /*total*/)
+    {
+        static_cast<AudioMixer *>(userdata)->mix(stream, additional);
+    }
+
+    void mix(SDL_AudioStream *stream, int bytes)
+    {
+        const Uint64 now = SDL_GetTicksNS();
+        if (lastCallback && now - lastCallback > 2 * bufferNS)
+        {
+            underruns++;
+        }
+        lastCallback = now;
+
+        const int frameBytes = CHANNELS * sizeof(float);
+        for (int frames = bytes / frameBytes; frames > 0; frames -= MIX_FRAMES)
+        {
+            const size_t count = std::min(frames, MIX_FRAMES) * CHANNELS;
+            std::fill(mixBuffer.begin(), mixBuffer.begin() + count, 0.0f);
+
+            for (Voice &voice : voices)
+            {
+                if (voice.sound < 0)
+                {
+                    continue;
+                }
+                if (voice.triggeredAt)
+                {
+                    const Uint64 latency = now - voice.triggeredAt + bufferNS;
+                    latencyNS = latency;
+                    maxLatencyNS = std::max(maxLatencyNS.load(), latency);
+                    voice.triggeredAt = 0;
+                }
+
+                const std::vector<float> &samples = sounds[voice.sound].samples;
+                const size_t n = std::min(count, samples.size() - voice.position);
+                for (size_t i = 0; i < n; i++)
+                {
+                    mixBuffer[i] += samples[voice.position + i] * voice.volume;
+                }
+                voice.position += n;
+                if (voice.position >= samples.size())
+                {
+                    voice.sound = -1;
+                }
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                mixBuffer[i] = std::clamp(mixBuffer[i], -1.0f, 1.0f);
+            }
+            SDL_PutAudioStreamData(stream, mixBuffer.data(), static_cast<int>(count * sizeof(float)));
+        }
+    }
+
+    // Finds the "fmt " and "data" chunks of a RIFF WAVE file, leaving the file at the start of the samples
+    bool openWav(const char *path, SDL_AudioSpec &fileSpec)
+    {
+        musicFile = SDL_IOFromFile(path, "rb");
+        char riff[12];
+        if (!musicFile || SDL_ReadIO(musicFile, riff, 12) != 12 || std::memcmp(riff, "RIFF", 4) || std::memcmp(riff + 8, "WAVE", 4))
+        {
+            SDL_Log("Music %s is not a WAV file, only WAV is streamed", path);
+            return false;
+        }
+
+        bool haveFormat = false;
+        char id[4];
+        Uint32 size;
+        while (SDL_ReadIO(musicFile, id, 4) == 4 && SDL_ReadU32LE(musicFile, &size))
+        {
+            const Sint64 next = SDL_TellIO(musicFile) + size + (size & 1);
+            if (!std::memcmp(id, "fmt ", 4))
+            {
+                Uint16 tag, channels, blockAlign, bits;
+                Uint32 rate, byteRate;
+                SDL_ReadU16LE(musicFile, &tag);
+                SDL_ReadU16LE(musicFile, &channels);
+                SDL_ReadU32LE(musicFile, &rate);
+                SDL_ReadU32LE(musicFile, &byteRate);
+                SDL_ReadU16LE(musicFile, &blockAlign);
+                SDL_ReadU16LE(musicFile, &bits);
+
+                fileSpec.channels = channels;
+                fileSpec.freq = static_cast<int>(rate);
+                musicBytesPerSecond = static_cast<int>(byteRate);
+                if (tag == 3 && bits == 32)
+                    fileSpec.format = SDL_AUDIO_F32LE;
+                else if (tag == 1 && bits == 16)
+                    fileSpec.format = SDL_AUDIO_S16LE;
+                else if (tag == 1 && bits == 32)
+                    fileSpec.format = SDL_AUDIO_S32LE;
+                else if (tag == 1 && bits == 8)
+                    fileSpec.format = SDL_AUDIO_U8;
+                else
+                {
+                    SDL_Log("Music %s uses an unsupported WAV encoding", path);
+                    return false;
+                }
+                haveFormat = true;
+            }
+            else if (!std::memcmp(id, "data", 4))
+            {
+                musicDataStart = SDL_TellIO(musicFile);
+                musicDataSize = size;
+                return haveFormat;
+            }
+            SDL_SeekIO(musicFile, next, SDL_IO_SEEK_SET);
+        }
+        return false;
+    }
+
+public:
+    ~AudioMixer() { close(); }
+
+    bool isOpen() const { return sfxStream != nullptr; }
+
+    // Opens the default playback device; the game carries on silently when this fails
+    bool open()
+    {
+        // ask for a small device buffer, it bounds how long a triggered sound waits to be heard
+        SDL_SetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES, std::to_string(DEVICE_FRAMES).c_str());
+        sfxStream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, feed, this);
+        if (!sfxStream)
+        {
+            SDL_Log("Could not open audio device: %s", SDL_GetError());
+            return false;
+        }
+
+        SDL_AudioSpec deviceSpec;
+        int deviceFrames = DEVICE_FRAMES;
+        SDL_GetAudioDeviceFormat(SDL_GetAudioStreamDevice(sfxStream), &deviceSpec, &deviceFrames);
+        bufferNS = static_cast<Uint64>(deviceFrames) * 1000000000 / deviceSpec.freq;
+        mixBuffer.resize(MIX_FRAMES * CHANNELS);
+        musicChunk.resize(MUSIC_CHUNK);
+
+        SDL_ResumeAudioStreamDevice(sfxStream);
+        return true;
+    }
+
+    void close()
+    {
+        stopMusic();
+        SDL_DestroyAudioStream(sfxStream);
+        sfxStream = nullptr;
+        sounds.clear();
+    }
+
+    // Converts a decoded sound into the pool under its asset ID
+    void addSound(uint32_t id, const DecodedAudio &audio)
+    {
+        if (!isOpen() || audio.pcm.empty())
+        {
+            return;
+        }
+        Uint8 *converted = nullptr;
+        int length = 0;
+        if (!SDL_ConvertAudioSamples(&audio.spec, audio.pcm.data(), static_cast<int>(audio.pcm.size()), &spec, &converted, &length))
+        {
+            SDL_Log("Could not convert sound: %s", SDL_GetError());
+            return;
+        }
+        Sound sound{id, std::vector<float>(length / sizeof(float))};
+        std::memcpy(sound.samples.data(), converted, sound.samples.size() * sizeof(float));
+        SDL_free(converted);
+
+        SDL_LockAudioStream(sfxStream);
+        sounds.push_back(std::move(sound));
+        SDL_UnlockAudioStream(sfxStream);
+    }
+
+    // Starts a sound from the pool, taking over the voice closest to finishing if none is free
+    void play(uint32_t id, float volume = 1.0f)
+    {
+        if (!isOpen())
+        {
+            return;
+        }
+        SDL_LockAudioStream(sfxStream);
+        auto sound = std::find_if(sounds.begin(), sounds.end(), [id](const Sound &s)
+                                  { return s.id == id; });
+        if (sound != sounds.end())
+        {
+            Voice *target = nullptr;
+            size_t leastLeft = SIZE_MAX;
+            for (Voice &voice : voices)
+            {
+                if (voice.sound < 0)
+                {
+                    target = &voice;
+                    break;
+                }
+                const size_t left = sounds[voice.sound].samples.size() - voice.position;
+                if (left < leastLeft)
+                {
+                    leastLeft = left;
+                    target = &voice;
+                }
+            }
+            if (target->sound >= 0)
+            {
+                voicesStolen++;
+            }
+            *target = Voice{static_cast<int>(sound - sounds.begin()), 0, volume, SDL_GetTicksNS()};
+        }
+        SDL_UnlockAudioStream(sfxStream);
+    }
+
+    // Streams a WAV file in a loop; other formats are not decoded
+    bool playMusic(const char *path, float volume = 0.5f)
+    {
+        stopMusic();
+        SDL_AudioSpec fileSpec;
+        if (!isOpen() || !openWav(path, fileSpec))
+        {
+            stopMusic();
+            return false;
+        }
+        musicStream = SDL_CreateAudioStream(&fileSpec, &spec);
+        if (!musicStream || !SDL_BindAudioStream(SDL_GetAudioStreamDevice(sfxStream), musicStream))
+        {
+            SDL_Log("Could not start music: %s", SDL_GetError());
+            stopMusic();
+            return false;
+        }
+        musicVolume = volume;
+        SDL_SetAudioStreamGain(musicStream, musicVolume);
+        musicRead = 0;
+        update();
+        return true;
+    }
+
+    void stopMusic()
+    {
+        SDL_DestroyAudioStream(musicStream); // also unbinds it
+        musicStream = nullptr;
+        SDL_CloseIO(musicFile);
+        musicFile = nullptr;
+    }
+
+    // Once per frame: keeps MUSIC_AHEAD seconds of music queued, reading it from disk a chunk at a time
+    void update()
+    {
+        if (!musicStream)
+        {
+            return;
+        }
+        if (musicRead > 0 && SDL_GetAudioStreamQueued(musicStream) == 0)
+        {
+            underruns++;
+        }
+        while (SDL_GetAudioStreamQueued(musicStream) < musicBytesPerSecond * MUSIC_AHEAD)
+        {
+            if (musicRead >= musicDataSize)
+            {
+                // loop the track
+                SDL_SeekIO(musicFile, musicDataStart, SDL_IO_SEEK_SET);
+                musicRead = 0;
+            }
+            const size_t want = static_cast<size_t>(std::min<Sint64>(MUSIC_CHUNK, musicDataSize - musicRead));
+            const size_t got = SDL_ReadIO(musicFile, musicChunk.data(), want);
+            if (got == 0)
+            {
+                break;
+            }
+            SDL_PutAudioStreamData(musicStream, musicChunk.data(), static_cast<int>(got));
+            musicRead += got;
+        }
+    }
+
+    AudioStats getStats() const
+    {
+        AudioStats stats;
+        if (!isOpen())
+        {
+            return stats;
+        }
+        stats.latencyMs = latencyNS / 1000000.0f;
+        stats.maxLatencyMs = maxLatencyNS / 1000000.0f;
+        stats.underruns = underruns;
+        stats.voicesStolen = voicesStolen;
+        SDL_LockAudioStream(sfxStream);
+        for (const Voice &voice : voices)
+        {
+            stats.activeVoices += voice.sound >= 0;
+        }
+        SDL_UnlockAudioStream(sfxStream);
+        return stats;
+    }
+};
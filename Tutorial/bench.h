@@ -0,0 +1,276 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+#include "profiler.h"
+
+// Settings of a headless benchmark run, from the --bench-* command line options
+struct BenchConfig
+{
+    bool enabled = false;
+    int frames = 1000;
+    int entities = 0;     // dynamic entities spawned in addition to the player
+    int enemies = 0;      // enemies spawned in addition to the level's own
+    int columns = 0;      // level width in tiles, 0 keeps the built in level
+    std::string script;   // input script, the built in one when empty
+    std::string output = "bench.json";
+    std::string baseline; // report of an earlier run to compare against
+    double tolerance = 0.10; // how much slower than the baseline a run may be before it fails
+    int allocWarmup = 300;   // frames that may still allocate, later ones fail the run when built with ALLOC_TRACKING
+    int rollback = 0;        // ticks rolled back and simulated again every frame, 0 for none
+
+    // Picks out the options it knows and leaves the rest alone
+    void parse(int argc, char *argv[])
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--bench")
+                enabled = true;
+            else if (arg == "--bench-frames" && hasValue)
+                frames = std::atoi(argv[++i]);
+            else if (arg == "--bench-entities" && hasValue)
+                entities = std::atoi(argv[++i]);
+            else if (arg == "--bench-enemies" && hasValue)
+                enemies = std::atoi(argv[++i]);
+            else if (arg == "--bench-columns" && hasValue)
+                columns = std::atoi(argv[++i]);
+            else if (arg == "--bench-script" && hasValue)
+                script = argv[++i];
+            else if (arg == "--bench-out" && hasValue)
+                output = argv[++i];
+            else if (arg == "--bench-baseline" && hasValue)
+                baseline = argv[++i];
+            else if (arg == "--bench-tolerance" && hasValue)
+                tolerance = std::atof(argv[++i]);
+            else if (arg == "--bench-alloc-warmup" && hasValue)
+                allocWarmup = std::atoi(argv[++i]);
+            else if (arg == "--bench-rollback" && hasValue)
+                rollback = std::max(std::atoi(argv[++i]), 0);
+        }
+    }
+};
+
+/*
+ * Plays back key presses at fixed frame numbers. A script has one event per line,
+ * "<frame> down|up <key name>", with key names as SDL_GetScancodeFromName knows them;
+ * the script loops once its last frame has passed.
+ */
+class BenchInput
+{
+    struct KeyEvent
+    {
+        int frame;
+        SDL_Scancode key;
+        bool down;
+    };
+
+    std::vector<KeyEvent> events; // sorted by frame
+    std::array<bool, SDL_SCANCODE_COUNT> keys{};
+    int length = 1;
+
+public:
+    BenchInput()
+    {
+        // run right, jump now and then, turn around, come back and stop
+        events = {
+            {0, SDL_SCANCODE_D, true},
+            {90, SDL_SCANCODE_SPACE, true},
+            {91, SDL_SCANCODE_SPACE, false},
+            {240, SDL_SCANCODE_D, false},
+            {240, SDL_SCANCODE_A, true},
+            {300, SDL_SCANCODE_SPACE, true},
+            {301, SDL_SCANCODE_SPACE, false},
+            {420, SDL_SCANCODE_A, false}};
+        length = 480;
+    }
+
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            return false;
+        }
+        events.clear();
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            int frame;
+            std::string action, name;
+            if (fields >> frame >> action >> name && name[0] != '#')
+            {
+                events.push_back({frame, SDL_GetScancodeFromName(name.c_str()), action == "down"});
+            }
+        }
+        std::stable_sort(events.begin(), events.end(), [](const KeyEvent &a, const KeyEvent &b)
+                         { return a.frame < b.frame; });
+        length = events.empty() ? 1 : events.back().frame + 1;
+        return true;
+    }
+
+    // Key state the game reads instead of the real keyboard
+    const bool *getKeys() const { return keys.data(); }
+
+    // Applies the events of 'frame' and calls onKey(key, down) for each one
+    template <typename Fn>
+    void play(int frame, Fn &&onKey)
+    {
+        const int f = frame % length;
+        if (f == 0)
+        {
+            keys.fill(false);
+        }
+        for (const KeyEvent &e : events)
+        {
+            if (e.frame == f && e.key != SDL_SCANCODE_UNKNOWN)
+            {
+                keys[e.key] = e.down;
+                onKey(e.key, e.down);
+            }
+        }
+    }
+};
+
+/*
+ * Collects frame and phase times of a run and writes them as one flat JSON object, so the
+ * report is easy to read back both by scripts and by checkBaseline().
+ */
+class BenchReport
+{
+    std::vector<double> frameMs;
+    std::array<std::vector<double>, PROFILE_PHASE_COUNT> phaseMs;
+    std::vector<std::pair<std::string, double>> values;
+
+    static double percentile(std::vector<double> samples, double p)
+    {
+        if (samples.empty())
+        {
+            return 0;
+        }
+        const size_t rank = std::min(static_cast<size_t>(p * (samples.size() - 1) + 0.5), samples.size() - 1);
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    }
+
+    static double mean(const std::vector<double> &samples)
+    {
+        double total = 0;
+        for (double s : samples)
+        {
+            total += s;
+        }
+        return samples.empty() ? 0 : total / samples.size();
+    }
+
+    static std::string key(const char *name)
+    {
+        std::string k = name;
+        std::replace(k.begin(), k.end(), ' ', '_');
+        return k;
+    }
+
+    static bool readValue(const std::string &json, const std::string &name, double &value)
+    {
+        const size_t at = json.find("\"" + name + "\":");
+        if (at == std::string::npos)
+        {
+            return false;
+        }
+        value = std::strtod(json.c_str() + at + name.size() + 3, nullptr);
+        return true;
+    }
+
+public:
+    void reserve(int frames)
+    {
+        frameMs.reserve(frames);
+        for (auto &phase : phaseMs)
+        {
+            phase.reserve(frames);
+        }
+    }
+
+    void addFrame(double ms, const std::array<double, PROFILE_PHASE_COUNT> &phases)
+    {
+        frameMs.push_back(ms);
+        for (size_t p = 0; p < PROFILE_PHASE_COUNT; p++)
+        {
+            phaseMs[p].push_back(phases[p]);
+        }
+    }
+
+    // Extra values that describe the run, written before the timings
+    void set(const std::string &name, double value) { values.push_back({name, value}); }
+
+    bool write(const std::string &path)
+    {
+        std::ostringstream json;
+        json << "{\n";
+        for (const auto &[name, value] : values)
+        {
+            json << "  \"" << name << "\": " << value << ",\n";
+        }
+        json << "  \"frame_mean_ms\": " << mean(frameMs) << ",\n"
+             << "  \"frame_p50_ms\": " << percentile(frameMs, 0.5) << ",\n"
+             << "  \"frame_p99_ms\": " << percentile(frameMs, 0.99) << ",\n"
+             << "  \"frame_max_ms\": " << percentile(frameMs, 1.0);
+        for (size_t p = 0; p < PROFILE_PHASE_COUNT; p++)
+        {
+            json << ",\n  \"" << key(PROFILE_PHASE_NAMES[p]) << "_mean_ms\": " << mean(phaseMs[p])
+                 << ",\n  \"" << key(PROFILE_PHASE_NAMES[p]) << "_p99_ms\": " << percentile(phaseMs[p], 0.99);
+        }
+        json << "\n}\n";
+
+        std::cout << json.str();
+        std::ofstream out(path);
+        out << json.str();
+        return static_cast<bool>(out);
+    }
+
+    /**
+     * @brief Compares mean and p99 frame time with an earlier report.
+     * @param path The earlier report.
+     * @param tolerance Allowed slowdown as a fraction, 0.1 lets a run be 10% slower.
+     * @return False if this run is slower than the baseline allows or the baseline cannot be read.
+     */
+    bool checkBaseline(const std::string &path, double tolerance) const
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cout << "Could not read baseline " << path << std::endl;
+            return false;
+        }
+        const std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        bool ok = true;
+        const std::pair<const char *, double> checks[] = {
+            {"frame_mean_ms", mean(frameMs)},
+            {"frame_p99_ms", percentile(frameMs, 0.99)}};
+        for (const auto &[name, current] : checks)
+        {
+            double base;
+            if (!readValue(json, name, base))
+            {
+                std::cout << "Baseline has no " << name << std::endl;
+                ok = false;
+            }
+            else if (current > base * (1.0 + tolerance))
+            {
+                std::cout << "Regression: " << name << " " << current << " ms, baseline " << base << " ms" << std::endl;
+                ok = false;
+            }
+        }
+        return ok;
+    }
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <algorithm>
+
+// Two bodies whose bounds overlap and that still need an exact (narrowphase) test
+struct BroadphasePair
+{
+    int a, b;
+};
+
+// Counters for the current frame, next to what the old all-pairs loop would have tested
+struct BroadphaseStats
+{
+    size_t dynamicBodies = 0;
+    size_t candidatePairs = 0;
+    size_t bruteForcePairs = 0;
+};
+
+inline bool boundsOverlap(const SDL_FRect &a, const SDL_FRect &b)
+{
+    // touching edges count as overlapping so a body resting on the floor still finds it
+    return a.x <= b.x + b.w && b.x <= a.x + a.w &&
+           a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+/*
+ * Sweep and prune on the x axis for moving bodies.
+ * The sort order is kept between frames, and since bodies only move a little per frame
+ * the insertion sort that restores it is close to linear.
+ */
+class SweepAndPrune
+{
+    struct Body
+    {
+        int id;
+        SDL_FRect bounds;
+    };
+
+    std::vector<Body> bodies;
+    std::vector<int> order; // indices into bodies sorted by bounds.x
+
+public:
+    size_t size() const { return bodies.size(); }
+
+    void reserve(size_t count)
+    {
+        bodies.reserve(count);
+        order.reserve(count);
+    }
+
+    // Bodies must be added in the same order every frame for the previous sort order to be reused
+    void clear() { bodies.clear(); }
+    void add(int id, const SDL_FRect &bounds) { bodies.push_back({id, bounds}); }
+
+    void findPairs(std::vector<BroadphasePair> &out)
+    {
+        if (order.size() != bodies.size())
+        {
+            order.resize(bodies.size());
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                order[i] = static_cast<int>(i);
+            }
+        }
+
+        for (size_t i = 1; i < order.size(); i++)
+        {
+            const int slot = order[i];
+            const float x = bodies[slot].bounds.x;
+            size_t j = i;
+            while (j > 0 && bodies[order[j - 1]].bounds.x > x)
+            {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = slot;
+        }
+
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const Body &a = bodies[order[i]];
+            const float maxX = a.bounds.x + a.bounds.w;
+            for (size_t j = i + 1; j < order.size(); j++)
+            {
+                const Body &b = bodies[order[j]];
+                if (b.bounds.x > maxX)
+                {
+                    break; // sorted on x, so nothing further along can overlap either
+                }
+                if (boundsOverlap(a.bounds, b.bounds))
+                {
+                    out.push_back({a.id, b.id});
+                }
+            }
+        }
+    }
+};
+
+/*
+ * Collects candidate collision pairs between moving bodies with sweep and prune.
+ * Level tiles are not bodies, the narrowphase looks them up in the tile map directly.
+ */
+class Broadphase
+{
+    SweepAndPrune dynamicBodies;
+    std::vector<BroadphasePair> dynamicPairs; // both directions, sorted by a
+    BroadphaseStats stats;
+
+public:
+    // Room for 'bodies' moving bodies with 'pairsPerBody' pairs each, on average; does nothing once there is enough
+    void reserve(size_t bodies, size_t pairsPerBody)
+    {
+        dynamicBodies.reserve(bodies);
+        dynamicPairs.reserve(bodies * pairsPerBody);
+    }
+
+    // Start of the frame: forget last frame's moving bodies and pair counts
+    void beginFrame()
+    {
+        dynamicBodies.clear();
+        dynamicPairs.clear();
+        stats = BroadphaseStats();
+    }
+
+    // 'bounds' should cover the whole move of this frame
+    void addDynamic(int id, const SDL_FRect &bounds) { dynamicBodies.add(id, bounds); }
+
+    // Call once all moving bodies have been added
+    void findDynamicPairs()
+    {
+        const size_t first = dynamicPairs.size();
+        dynamicBodies.findPairs(dynamicPairs);
+        const size_t last = dynamicPairs.size();
+        for (size_t i = first; i < last; i++)
+        {
+            dynamicPairs.push_back({dynamicPairs[i].b, dynamicPairs[i].a});
+        }
+        std::sort(dynamicPairs.begin(), dynamicPairs.end(),
+                  [](const BroadphasePair &l, const BroadphasePair &r)
+                  { return l.a < r.a; });
+
+        stats.dynamicBodies = dynamicBodies.size();
+        const size_t total = stats.dynamicBodies;
+        stats.bruteForcePairs = total * (total - (total > 0 ? 1 : 0));
+    }
+
+    // Appends every moving body paired with 'id', each at most once.
+    // Safe to call from several threads at once; callers report what they found through addCandidatePairs().
+    void query(int id, std::vector<int> &out) const
+    {
+        auto range = std::equal_range(dynamicPairs.begin(), dynamicPairs.end(), BroadphasePair{id, 0},
+                                      [](const BroadphasePair &l, const BroadphasePair &r)
+                                      { return l.a < r.a; });
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            out.push_back(it->b);
+        }
+    }
+
+    void addCandidatePairs(size_t count) { stats.candidatePairs += count; }
+
+    const BroadphaseStats &getStats() const { return stats; }
+};
@@ -0,0 +1,103 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// What one narrowphase test found: which way to push the moving box out, how far, and when it hit
+struct ContactManifold
+{
+    glm::vec2 normal;  // unit axis pointing away from the obstacle, (0, -1) for a floor
+    float penetration; // how deep the boxes already overlap, 0 for a hit found by sweeping
+    float toi;         // time of impact as a fraction of the displacement, 0 when already overlapping
+};
+
+/**
+ * @brief Overlap test between two boxes, the normal on the axis of least overlap.
+ * @param a The box to push out.
+ * @param b The obstacle.
+ * @param manifold Filled in when the boxes overlap; touching edges do not count.
+ * @return True if the boxes overlap.
+ */
+inline bool overlapAabb(const SDL_FRect &a, const SDL_FRect &b, ContactManifold &manifold)
+{
+    const float overlapX = std::min(a.x + a.w, b.x + b.w) - std::max(a.x, b.x);
+    const float overlapY = std::min(a.y + a.h, b.y + b.h) - std::max(a.y, b.y);
+    if (overlapX <= 0 || overlapY <= 0)
+    {
+        return false;
+    }
+    // push out towards the side a's centre is on
+    if (overlapX < overlapY)
+    {
+        manifold.normal = {(a.x + a.w * 0.5f < b.x + b.w * 0.5f) ? -1.0f : 1.0f, 0};
+        manifold.penetration = overlapX;
+    }
+    else
+    {
+        manifold.normal = {0, (a.y + a.h * 0.5f < b.y + b.h * 0.5f) ? -1.0f : 1.0f};
+        manifold.penetration = overlapY;
+    }
+    manifold.toi = 0;
+    return true;
+}
+
+/**
+ * @brief Swept test of a box moving by a displacement against a box standing still.
+ * Boxes that already overlap give a penetration manifold instead, so the caller handles both the same way.
+ * @param a The moving box where it starts.
+ * @param displacement How far it moves.
+ * @param b The obstacle.
+ * @param manifold Filled in on a hit. Starting flush against b and moving into it is a hit at toi 0.
+ * @return True if a overlaps b or runs into it before the end of the displacement.
+ */
+inline bool sweepAabb(const SDL_FRect &a, glm::vec2 displacement, const SDL_FRect &b, ContactManifold &manifold)
+{
+    if (overlapAabb(a, b, manifold))
+    {
+        return true;
+    }
+
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float aMin[2] = {a.x, a.y}, aMax[2] = {a.x + a.w, a.y + a.h};
+    const float bMin[2] = {b.x, b.y}, bMax[2] = {b.x + b.w, b.y + b.h};
+    float entry[2], exit[2];
+    for (int axis = 0; axis < 2; axis++)
+    {
+        const float d = displacement[axis];
+        if (d == 0)
+        {
+            // not moving on this axis, so it has to overlap on it the whole time
+            if (aMax[axis] <= bMin[axis] || bMax[axis] <= aMin[axis])
+            {
+                return false;
+            }
+            entry[axis] = -infinity;
+            exit[axis] = infinity;
+        }
+        else if (d > 0)
+        {
+            entry[axis] = (bMin[axis] - aMax[axis]) / d;
+            exit[axis] = (bMax[axis] - aMin[axis]) / d;
+        }
+        else
+        {
+            entry[axis] = (bMax[axis] - aMin[axis]) / d;
+            exit[axis] = (bMin[axis] - aMax[axis]) / d;
+        }
+    }
+
+    const float toi = std::max(entry[0], entry[1]);
+    if (toi >= std::min(exit[0], exit[1]) || toi < 0 || toi > 1)
+    {
+        return false;
+    }
+    // the axis that started overlapping last is the one hit; on a tie (a corner) it counts as the floor or ceiling
+    const int axis = entry[0] > entry[1] ? 0 : 1;
+    manifold.normal = {0, 0};
+    manifold.normal[axis] = displacement[axis] > 0 ? -1.0f : 1.0f;
+    manifold.penetration = 0;
+    manifold.toi = toi;
+    return true;
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <array>
+#include <numeric>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#include "animation.h"
+#include "snapshot.h"
+
+enum class EnemyState : uint8_t
+{
+    patrol, // walks up and down its stretch of floor
+    chase,  // walks towards the player, but never off its stretch of floor
+    hit,    // stands still while the hit clip plays, then chases
+    dying,  // plays the die clip, then is gone
+    dead,
+    count
+};
+
+const size_t ENEMY_STATE_COUNT = static_cast<size_t>(EnemyState::count);
+
+const float ENEMY_SIZE = 32;                     // sprite frames are this square, position is the top left corner
+const SDL_FRect ENEMY_HITBOX = {8, 8, 16, 24};   // relative to the position
+const uint8_t ENEMY_HEALTH = 3;                  // bullets it takes
+const int ENEMY_MAX_PATROL_TILES = 8;            // how far from its spawn it walks, either way
+const float ENEMY_SPEED[ENEMY_STATE_COUNT] = {40, 80, 0, 0, 0}; // per state, in pixels per second
+const float ENEMY_SIGHT = 160;                   // horizontal distance it notices the player from
+const float ENEMY_SIGHT_HEIGHT = 48;             // and how far above or below
+const float ENEMY_LOSE_SIGHT = 240;              // horizontal distance it gives up chasing from
+
+// Update rate LOD, by distance from the view port
+const float ENEMY_NEAR_MARGIN = 64;  // this close or on screen: every tick
+const float ENEMY_FAR_DISTANCE = 960; // this close: every ENEMY_LOD_INTERVAL ticks, staggered. Further away: frozen
+const uint32_t ENEMY_LOD_INTERVAL = 4;
+
+/*
+ * Every enemy of the level, kept apart from the entity store: an enemy never leaves the stretch of floor
+ * it spawned on, so it needs neither the broadphase nor the collision phases, and its whole update is a
+ * little arithmetic on packed arrays. Each field has its own array and the per enemy logic is written as
+ * selects rather than branches, so a pass over a range of enemies is a straight loop the compiler can
+ * vectorise.
+ *
+ * The arrays are sorted by the left end of each enemy's patrol, so the enemies that can be anywhere near
+ * a given x are one contiguous index range, found by binary search. That is what keeps the cost down with
+ * thousands of enemies in a level: the ones near the view port are updated every tick, the ones further
+ * off screen every ENEMY_LOD_INTERVAL ticks (a different share of them each tick, with that many ticks'
+ * worth of delta time), and the rest are not looked at at all. Dead enemies keep their slot, so the order never changes
+ * after spawning.
+ */
+class EnemySystem
+{
+    std::vector<float> x, prevX, y;
+    std::vector<float> minX, maxX; // patrol, for the position
+    std::vector<float> direction;  // -1 or 1
+    std::vector<EnemyState> states;
+    std::vector<uint8_t> health;
+    std::vector<AnimationPlayhead> sprites;
+
+    std::array<uint16_t, ENEMY_STATE_COUNT> clips;
+    float maxReach = 0; // widest patrol plus the sprite, how far left of an x an enemy reaching it can start
+    uint32_t tick = 0;
+    size_t updated = 0;         // enemies stepped in the last update
+    int hits = 0, deaths = 0;   // since the last update
+
+    // Indices of the enemies whose patrol may overlap [left, right]
+    std::pair<size_t, size_t> range(float left, float right) const
+    {
+        const size_t begin = std::lower_bound(minX.begin(), minX.end(), left - maxReach) - minX.begin();
+        const size_t end = std::upper_bound(minX.begin() + begin, minX.end(), right) - minX.begin();
+        return {begin, end};
+    }
+
+    // One batched step of every stride-th enemy in [begin, end)
+    void step(size_t begin, size_t end, size_t stride, float deltaTime, glm::vec2 target, const AnimationLibrary &animations)
+    {
+        for (size_t i = begin; i < end; i += stride)
+        {
+            animations.step(sprites[i], deltaTime);
+        }
+        for (size_t i = begin; i < end; i += stride)
+        {
+            const EnemyState state = states[i];
+            const float dx = target.x - (x[i] + ENEMY_SIZE / 2);
+            const float dy = std::fabs(target.y - y[i]);
+            const bool sees = std::fabs(dx) < ENEMY_SIGHT && dy < ENEMY_SIGHT_HEIGHT;
+            const bool lost = std::fabs(dx) > ENEMY_LOSE_SIGHT || dy > ENEMY_SIGHT_HEIGHT;
+            const bool clipDone = sprites[i].finished || sprites[i].clip == NO_CLIP;
+
+            EnemyState next = state;
+            next = state == EnemyState::patrol && sees ? EnemyState::chase : next;
+            next = state == EnemyState::chase && lost ? EnemyState::patrol : next;
+            next = state == EnemyState::hit && clipDone ? EnemyState::chase : next;
+            next = state == EnemyState::dying && clipDone ? EnemyState::dead : next;
+
+            // a patrol turns round at either end, a chase just waits there
+            float facing = next == EnemyState::chase ? (dx < 0 ? -1.0f : 1.0f) : direction[i];
+            const float moved = x[i] + facing * ENEMY_SPEED[static_cast<size_t>(next)] * deltaTime;
+            const float clamped = std::clamp(moved, minX[i], maxX[i]);
+            facing = next == EnemyState::patrol && moved != clamped ? -facing : facing;
+
+            prevX[i] = x[i];
+            x[i] = clamped;
+            direction[i] = facing;
+            states[i] = next;
+            sprites[i].play(clips[static_cast<size_t>(next)]); // only restarts when the clip changes
+        }
+        updated += begin < end ? (end - begin + stride - 1) / stride : 0;
+    }
+
+public:
+    EnemySystem() { clips.fill(NO_CLIP); }
+
+    // Clips of the walking states, of being hit and of dying
+    void setClips(uint16_t walk, uint16_t hit, uint16_t die)
+    {
+        clips = {walk, walk, hit, die, NO_CLIP};
+    }
+
+    void clear()
+    {
+        for (auto *field : {&x, &prevX, &y, &minX, &maxX, &direction})
+        {
+            field->clear();
+        }
+        states.clear();
+        health.clear();
+        sprites.clear();
+        maxReach = 0;
+        tick = 0;
+    }
+
+    /**
+     * @brief Adds an enemy for a marker cell, standing on the first solid tile below the marker. It patrols as
+     * far as that floor goes on either side, up to a wall or ENEMY_MAX_PATROL_TILES. Call finishSpawning() once
+     * every enemy is added.
+     * @param row Row of the marker.
+     * @param column Column of the marker.
+     * @param rows Rows of the level.
+     * @param columns Columns of the level.
+     * @param origin Where the level's top left corner is.
+     * @param tileSize Size of a tile.
+     * @param isSolid Called as isSolid(row, column) for cells inside the level.
+     */
+    template <typename Fn>
+    void spawn(int row, int column, int rows, int columns, SDL_FPoint origin, float tileSize, Fn &&isSolid)
+    {
+        int floor = row + 1;
+        while (floor < rows && !isSolid(floor, column))
+        {
+            floor++;
+        }
+        // standing room on top of the floor, and floor under it
+        const auto walkable = [&](int c)
+        {
+            return c >= 0 && c < columns && (floor >= rows || isSolid(floor, c)) && !isSolid(floor - 1, c);
+        };
+        int left = column, right = column;
+        while (left > column - ENEMY_MAX_PATROL_TILES && walkable(left - 1))
+        {
+            left--;
+        }
+        while (right < column + ENEMY_MAX_PATROL_TILES && walkable(right + 1))
+        {
+            right++;
+        }
+
+        const float spawnX = origin.x + column * tileSize;
+        x.push_back(spawnX);
+        prevX.push_back(spawnX);
+        y.push_back(origin.y + floor * tileSize - ENEMY_SIZE);
+        minX.push_back(origin.x + left * tileSize);
+        maxX.push_back(std::max(minX.back(), origin.x + (right + 1) * tileSize - ENEMY_SIZE));
+        direction.push_back(x.size() % 2 ? 1.0f : -1.0f);
+        states.push_back(EnemyState::patrol);
+        health.push_back(ENEMY_HEALTH);
+        sprites.emplace_back().play(clips[0]);
+    }
+
+    // Sorts the enemies by where their patrol starts; lookups by position rely on it
+    void finishSpawning()
+    {
+        std::vector<size_t> order(x.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+                         { return minX[a] < minX[b]; });
+        const auto reorder = [&order](auto &field)
+        {
+            auto sorted = field;
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                sorted[i] = field[order[i]];
+            }
+            field.swap(sorted);
+        };
+        for (auto *field : {&x, &prevX, &y, &minX, &maxX, &direction})
+        {
+            reorder(*field);
+        }
+        reorder(states);
+        reorder(health);
+        reorder(sprites);
+
+        maxReach = 0;
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            maxReach = std::max(maxReach, maxX[i] - minX[i] + ENEMY_SIZE);
+        }
+    }
+
+    /**
+     * @brief Advances the enemies by one tick, each at the rate its distance from the view port calls for.
+     * @param view The view port the rates are picked for.
+     * @param target Centre of the player, what they look out for and chase.
+     * @param deltaTime Length of the tick in seconds.
+     * @param animations The library the clips are in.
+     */
+    void update(const SDL_FRect &view, glm::vec2 target, float deltaTime, const AnimationLibrary &animations)
+    {
+        hits = deaths = 0;
+        updated = 0;
+        const auto [nearBegin, nearEnd] = range(view.x - ENEMY_NEAR_MARGIN, view.x + view.w + ENEMY_NEAR_MARGIN);
+        const auto [farBegin, farEnd] = range(view.x - ENEMY_FAR_DISTANCE, view.x + view.w + ENEMY_FAR_DISTANCE);
+
+        step(nearBegin, nearEnd, 1, deltaTime, target, animations);
+
+        // the enemies whose index falls on this tick's phase, on both sides of the near ones
+        const size_t phase = tick % ENEMY_LOD_INTERVAL;
+        const auto firstInPhase = [phase](size_t begin)
+        {
+            return begin + (phase + ENEMY_LOD_INTERVAL - begin % ENEMY_LOD_INTERVAL) % ENEMY_LOD_INTERVAL;
+        };
+        const float farDelta = deltaTime * ENEMY_LOD_INTERVAL;
+        step(firstInPhase(farBegin), nearBegin, ENEMY_LOD_INTERVAL, farDelta, target, animations);
+        step(firstInPhase(nearEnd), farEnd, ENEMY_LOD_INTERVAL, farDelta, target, animations);
+        tick++;
+    }
+
+    /**
+     * @brief Checks a bullet against the enemies around it and damages the first one it is inside of.
+     * @param point Where the bullet is.
+     * @return True if it hit an enemy.
+     */
+    bool hitAt(glm::vec2 point)
+    {
+        const auto [begin, end] = range(point.x, point.x);
+        for (size_t i = begin; i < end; i++)
+        {
+            const bool alive = states[i] == EnemyState::patrol || states[i] == EnemyState::chase || states[i] == EnemyState::hit;
+            const float left = x[i] + ENEMY_HITBOX.x, top = y[i] + ENEMY_HITBOX.y;
+            if (!alive || point.x < left || point.x >= left + ENEMY_HITBOX.w ||
+                point.y < top || point.y >= top + ENEMY_HITBOX.h)
+            {
+                continue;
+            }
+            health[i]--;
+            states[i] = health[i] > 0 ? EnemyState::hit : EnemyState::dying;
+            sprites[i] = {}; // so being hit again restarts the hit clip
+            sprites[i].play(clips[static_cast<size_t>(states[i])]);
+            hits++;
+            deaths += states[i] == EnemyState::dying;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Calls fn(playhead, position, flipped) for every enemy that is not dead yet and may be in view.
+     * @param view The view port.
+     * @param alpha Where between the last two ticks to place them.
+     */
+    template <typename Fn>
+    void forEachVisible(const SDL_FRect &view, float alpha, Fn &&fn) const
+    {
+        const auto [begin, end] = range(view.x - ENEMY_SIZE, view.x + view.w);
+        for (size_t i = begin; i < end; i++)
+        {
+            const float drawX = prevX[i] + (x[i] - prevX[i]) * alpha;
+            if (states[i] != EnemyState::dead && drawX + ENEMY_SIZE > view.x && drawX < view.x + view.w)
+            {
+                fn(sprites[i], glm::vec2(drawX, y[i]), direction[i] < 0);
+            }
+        }
+    }
+
+    // What ticks change; the patrols are fixed once spawned and are not part of it
+    void save(Snapshot &out) const
+    {
+        out.write(tick);
+        out.write(x);
+        out.write(prevX);
+        out.write(direction);
+        out.write(states);
+        out.write(health);
+        out.write(sprites);
+    }
+
+    void load(Snapshot &in)
+    {
+        in.read(tick);
+        in.read(x);
+        in.read(prevX);
+        in.read(direction);
+        in.read(states);
+        in.read(health);
+        in.read(sprites);
+    }
+
+    size_t size() const { return x.size(); }
+    float getX(size_t index) const { return x[index]; }
+    EnemyState getState(size_t index) const { return states[index]; }
+    // Enemies stepped in the last update, the ones frozen by distance not counted
+    size_t getUpdated() const { return updated; }
+    // Enemies hit, and how many of them died, since the last update
+    int getHits() const { return hits; }
+    int getDeaths() const { return deaths; }
+};
@@ -0,0 +1,172 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <cstdint>
+
+#include "gameObject.h"
+#include "snapshot.h"
+
+// Stable reference to an entity, stays valid (or detectably stale) while other entities come and go
+struct EntityHandle
+{
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const EntityHandle &other) const = default;
+};
+
+/*
+ * Structure-of-arrays entity storage.
+ * Every component lives in its own dense array and entity i owns element i of each,
+ * so a pass that only needs positions and velocities streams through just those arrays.
+ * Destroying an entity moves the last one into its place; handles go through a slot
+ * table so they keep pointing at the right entity.
+ */
+class EntityStore
+{
+    struct Slot
+    {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> owners; // slot of each dense index
+
+public:
+    std::vector<ObjectType> types;
+    std::vector<ObjectData> data;
+    std::vector<Transform> transforms;
+    std::vector<PhysicsBody> bodies;
+    std::vector<SDL_FRect> colliders;
+    std::vector<Sprite> sprites;
+
+    size_t size() const { return types.size(); }
+
+    void reserve(size_t count)
+    {
+        owners.reserve(count);
+        types.reserve(count);
+        data.reserve(count);
+        transforms.reserve(count);
+        bodies.reserve(count);
+        colliders.reserve(count);
+        sprites.reserve(count);
+    }
+
+    EntityHandle create(ObjectType type)
+    {
+        uint32_t slot;
+        if (!freeSlots.empty())
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.push_back({0, 0});
+        }
+        slots[slot].dense = static_cast<uint32_t>(size());
+
+        owners.push_back(slot);
+        types.push_back(type);
+        data.emplace_back();
+        transforms.emplace_back();
+        bodies.emplace_back();
+        colliders.push_back(SDL_FRect{0, 0, 0, 0});
+        sprites.emplace_back();
+        return EntityHandle{slot, slots[slot].generation};
+    }
+
+    bool isValid(EntityHandle h) const
+    {
+        return h.slot < slots.size() && slots[h.slot].generation == h.generation;
+    }
+
+    // Dense index of a live entity, valid until the next create() or destroy()
+    size_t indexOf(EntityHandle h) const
+    {
+        SDL_assert(isValid(h));
+        return slots[h.slot].dense;
+    }
+
+    EntityHandle handleOf(size_t index) const
+    {
+        return EntityHandle{owners[index], slots[owners[index]].generation};
+    }
+
+    void destroy(EntityHandle h)
+    {
+        if (!isValid(h))
+        {
+            return;
+        }
+
+        const size_t index = slots[h.slot].dense;
+        const size_t last = size() - 1;
+        if (index != last)
+        {
+            types[index] = types[last];
+            data[index] = data[last];
+            transforms[index] = transforms[last];
+            bodies[index] = bodies[last];
+            colliders[index] = colliders[last];
+            sprites[index] = sprites[last];
+            owners[index] = owners[last];
+            slots[owners[index]].dense = static_cast<uint32_t>(index);
+        }
+
+        owners.pop_back();
+        types.pop_back();
+        data.pop_back();
+        transforms.pop_back();
+        bodies.pop_back();
+        colliders.pop_back();
+        sprites.pop_back();
+
+        slots[h.slot].generation++; // every outstanding handle to this entity is now stale
+        freeSlots.push_back(h.slot);
+    }
+
+    // Every entity and the slot table, so handles stay valid across a rollback
+    void save(Snapshot &out) const
+    {
+        out.write(slots);
+        out.write(freeSlots);
+        out.write(owners);
+        out.write(types);
+        out.write(data);
+        out.write(transforms);
+        out.write(bodies);
+        out.write(colliders);
+        out.write(sprites);
+    }
+
+    void load(Snapshot &in)
+    {
+        in.read(slots);
+        in.read(freeSlots);
+        in.read(owners);
+        in.read(types);
+        in.read(data);
+        in.read(transforms);
+        in.read(bodies);
+        in.read(colliders);
+        in.read(sprites);
+    }
+
+    void clear()
+    {
+        slots.clear();
+        freeSlots.clear();
+        owners.clear();
+        types.clear();
+        data.clear();
+        transforms.clear();
+        bodies.clear();
+        colliders.clear();
+        sprites.clear();
+    }
+};
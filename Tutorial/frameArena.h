@@ -0,0 +1,105 @@
+#pragma once
+#include <memory_resource>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Bump allocator for memory that only has to last until the end of the frame: allocating moves a pointer,
+ * freeing does nothing, and reset() at the top of the next frame takes everything back at once. It is a
+ * std::pmr::memory_resource, so standard containers use it through std::pmr::vector and friends; those
+ * must not outlive the frame they were made in.
+ *
+ * A frame that needs more than the block gets the rest from the heap, and the next reset() replaces the
+ * block with one big enough for that frame, so after the first few frames nothing reaches the heap any
+ * more. One arena per thread, it does no locking.
+ */
+class FrameArena : public std::pmr::memory_resource
+{
+    // Heap allocations of a frame that did not fit into the block, freed by reset()
+    struct Overflow
+    {
+        Overflow *next;
+        size_t alignment; // to free it with
+    };
+
+    std::unique_ptr<std::byte[]> block;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t needed = 0;  // bytes the frame asked for, block and overflow together
+    size_t peak = 0;    // most any frame needed
+    Overflow *overflow = nullptr;
+
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+        const size_t start = ((base + used + alignment - 1) & ~(alignment - 1)) - base;
+        needed += bytes + alignment - 1;
+        if (block && start + bytes <= capacity)
+        {
+            used = start + bytes;
+            return block.get() + start;
+        }
+
+        // the header is padded up to the alignment so the memory after it stays aligned
+        const size_t header = (sizeof(Overflow) + alignment - 1) & ~(alignment - 1);
+        std::byte *memory = static_cast<std::byte *>(::operator new(header + bytes, std::align_val_t(alignment)));
+        overflow = new (memory + header - sizeof(Overflow)) Overflow{overflow, alignment};
+        return memory + header;
+    }
+
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    void freeOverflow()
+    {
+        while (overflow)
+        {
+            Overflow *next = overflow->next;
+            const size_t alignment = overflow->alignment;
+            const size_t header = (sizeof(Overflow) + alignment - 1) & ~(alignment - 1);
+            ::operator delete(reinterpret_cast<std::byte *>(overflow) + sizeof(Overflow) - header, std::align_val_t(alignment));
+            overflow = next;
+        }
+    }
+
+public:
+    explicit FrameArena(size_t initialBytes = 64 * 1024) { grow(initialBytes); }
+    ~FrameArena() { freeOverflow(); }
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // Replaces the block with one of at least 'bytes'; everything allocated so far is gone
+    void grow(size_t bytes)
+    {
+        size_t size = 4096;
+        while (size < bytes)
+        {
+            size *= 2;
+        }
+        block = std::make_unique<std::byte[]>(size);
+        capacity = size;
+        used = 0;
+    }
+
+    // Call at the top of every frame; everything allocated from the arena since the last reset is gone
+    void reset()
+    {
+        peak = needed > peak ? needed : peak;
+        if (overflow)
+        {
+            freeOverflow();
+            grow(peak);
+        }
+        used = 0;
+        needed = 0;
+    }
+
+    size_t getUsed() const { return used; }
+    size_t getCapacity() const { return capacity; }
+    // The most one frame asked for since the arena was made
+    size_t getPeak() const { return peak > needed ? peak : needed; }
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <array>
+#include <algorithm>
+#include <string_view>
+#include <cmath>
+
+enum class PacingMode
+{
+    vsync,    // present waits for the display; a cap at the display rate where the renderer cannot do vsync
+    capped,   // a fixed frame rate, timed by the pacer
+    unbounded // as fast as it goes
+};
+
+// "vsync", "cap" or "unbounded"; false for anything else
+inline bool parsePacingMode(std::string_view name, PacingMode &mode)
+{
+    if (name == "vsync")
+        mode = PacingMode::vsync;
+    else if (name == "cap")
+        mode = PacingMode::capped;
+    else if (name == "unbounded")
+        mode = PacingMode::unbounded;
+    else
+        return false;
+    return true;
+}
+
+/*
+ * Frame timing to the nanosecond (SDL_GetTicksNS) and the wait that caps the frame rate.
+ * A capped frame sleeps until shortly before its deadline and spins the rest of the way, since
+ * the scheduler wakes a sleeping thread up late by an amount that varies from OS to OS. How long it
+ * spins follows the oversleep actually seen, so it only burns as much CPU as the timer needs.
+ * Deadlines advance by exactly one frame each time, so the cap does not drift.
+ */
+class FramePacer
+{
+public:
+    static const int STATS_FRAMES = 120; // frames the average and jitter are taken over
+
+private:
+    static const Uint64 MIN_SPIN_NS = 200000;
+    static const Uint64 MAX_SPIN_NS = 4000000;
+    static const Uint64 SPIN_SLACK_NS = 250000; // spun on top of the worst recent oversleep
+
+    PacingMode mode = PacingMode::unbounded;
+    Uint64 targetNS = 0; // frame length when capped
+    Uint64 deadline = 0; // when the current frame should end
+    Uint64 spinNS = 2000000;
+    Uint64 frameStart = 0;
+
+    std::array<float, STATS_FRAMES> frameMs{}; // ring buffer of frame lengths
+    size_t frameCount = 0;
+
+public:
+    /**
+     * @brief Switches the pacing mode, also on the renderer.
+     * @param renderer The renderer, to turn vsync on or off.
+     * @param newMode The mode wanted.
+     * @param fps Frame rate of the cap; also used for vsync when the renderer has no vsync.
+     */
+    void setMode(SDL_Renderer *renderer, PacingMode newMode, float fps)
+    {
+        mode = newMode;
+        targetNS = static_cast<Uint64>(1e9 / std::max(fps, 1.0f));
+        if (!SDL_SetRenderVSync(renderer, mode == PacingMode::vsync ? 1 : SDL_RENDERER_VSYNC_DISABLED) &&
+            mode == PacingMode::vsync)
+        {
+            SDL_Log("No vsync (%s), capping at %.0f fps instead", SDL_GetError(), fps);
+            mode = PacingMode::capped;
+        }
+        deadline = 0;
+    }
+
+    PacingMode getMode() const { return mode; }
+
+    // Call at the start of every frame; returns the time since the last call in seconds
+    float beginFrame()
+    {
+        const Uint64 now = SDL_GetTicksNS();
+        const Uint64 length = frameStart ? now - frameStart : 0;
+        frameStart = now;
+        if (length)
+        {
+            frameMs[frameCount++ % STATS_FRAMES] = length / 1e6f;
+        }
+        return length / 1e9f;
+    }
+
+    // Call at the end of every frame, after present; waits for the frame's deadline when capped
+    void endFrame()
+    {
+        if (mode != PacingMode::capped)
+        {
+            return;
+        }
+        Uint64 now = SDL_GetTicksNS();
+        deadline += targetNS;
+        if (deadline + targetNS < now || deadline > now + targetNS)
+        {
+            // a frame or more late (or the first frame): start counting from here instead of rushing to catch up
+            deadline = now + targetNS;
+        }
+
+        if (deadline > now + spinNS)
+        {
+            const Uint64 wake = deadline - spinNS;
+            SDL_DelayNS(wake - now);
+            now = SDL_GetTicksNS();
+            const Uint64 oversleep = now > wake ? now - wake : 0;
+            spinNS = std::clamp(std::max(oversleep + SPIN_SLACK_NS, spinNS - spinNS / 64), MIN_SPIN_NS, MAX_SPIN_NS);
+        }
+        while (now < deadline)
+        {
+            SDL_CPUPauseInstruction();
+            now = SDL_GetTicksNS();
+        }
+    }
+
+    // Average frame length over the last STATS_FRAMES frames
+    float getFrameMs() const
+    {
+        const size_t count = std::min<size_t>(frameCount, STATS_FRAMES);
+        float total = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            total += frameMs[i];
+        }
+        return count ? total / count : 0;
+    }
+
+    // Standard deviation of the frame length over the last STATS_FRAMES frames, 0 for perfectly even frames
+    float getJitterMs() const
+    {
+        const size_t count = std::min<size_t>(frameCount, STATS_FRAMES);
+        const float mean = getFrameMs();
+        float variance = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            variance += (frameMs[i] - mean) * (frameMs[i] - mean);
+        }
+        return count ? std::sqrt(variance / count) : 0;
+    }
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+/*
+ * Hands frames from a producer stage to a consumer stage running on another thread, through a
+ * ring of Count frames that are reused over and over. The producer fills the next frame while the
+ * consumer still works on older ones, and only waits once all Count frames are waiting to be
+ * consumed (or being consumed), so with Count = 3 it can run up to two frames ahead. Whichever
+ * stage is slower sets the pace; the other one waits on it instead of adding its own time.
+ */
+template <typename Frame, size_t Count = 3>
+class FramePipeline
+{
+    std::array<Frame, Count> frames;
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t produced = 0; // frames handed over so far
+    size_t consumed = 0; // frames given back so far
+    bool stopped = false;
+
+public:
+    static_assert(Count >= 2, "a single frame cannot be produced and consumed at the same time");
+
+    // The frame to fill next, waiting for one to come free; null once stopped
+    Frame *beginProduce()
+    {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [this]
+                     { return stopped || produced - consumed < Count; });
+        return stopped ? nullptr : &frames[produced % Count];
+    }
+
+    // Hands the frame from beginProduce() to the consumer
+    void endProduce()
+    {
+        {
+            std::lock_guard lock(mutex);
+            produced++;
+        }
+        changed.notify_all();
+    }
+
+    // The oldest frame not consumed yet, waiting for the producer if there is none; null once stopped
+    Frame *beginConsume()
+    {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [this]
+                     { return stopped || consumed < produced; });
+        return stopped ? nullptr : &frames[consumed % Count];
+    }
+
+    // Gives the frame from beginConsume() back to the producer
+    void endConsume()
+    {
+        {
+            std::lock_guard lock(mutex);
+            consumed++;
+        }
+        changed.notify_all();
+    }
+
+    // Wakes both stages up and makes every further begin return null
+    void stop()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopped = true;
+        }
+        changed.notify_all();
+    }
+};
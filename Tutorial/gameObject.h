@@ -4,6 +4,7 @@
 #include <SDL3/SDL.h>
 
 #include "animation.h"
+#include "atlasRegion.h"
 
 enum class PlayerState
 {
@@ -12,13 +13,35 @@ enum class PlayerState
     jumping
 };
 
+const size_t MAX_PLAYERS = 2;
+
+// Buttons of a PlayerInput
+const uint8_t INPUT_LEFT = 1;
+const uint8_t INPUT_RIGHT = 2;
+const uint8_t INPUT_JUMP = 4;
+const uint8_t INPUT_SHOOT = 8;
+
+// What one player does in one tick; the simulation reads this, never the keyboard
+struct PlayerInput
+{
+    uint8_t held = 0;    // buttons held during the tick
+    uint8_t pressed = 0; // buttons pressed in it
+
+    bool operator==(const PlayerInput &other) const = default;
+};
+
 struct PlayerData
 {
     PlayerState state;
+    float shootCooldown; // seconds until the next bullet can be fired
+    uint8_t number;      // whose input moves it
+    uint8_t padding[3] = {}; // spelled out: snapshots copy and hash raw bytes, none may be left undefined
 
     PlayerData()
     {
         state = PlayerState::idle;
+        shootCooldown = 0;
+        number = 0;
     }
 };
 
@@ -35,43 +58,55 @@ union ObjectData
     PlayerData player;
     LevelData level;
     EnemyData enemy;
+
+    // through the largest member, so every byte is set whatever the entity is
+    ObjectData() : player() {}
 };
 
 enum class ObjectType
 {
     player,
-    enemy,
-    level
+    enemy
 };
 
-struct GameObject
-{
-    ObjectType type;
-    ObjectData data;
-    glm::vec2 position, acceleration, velocity;
+// Components of an entity, each kept in its own dense array by the EntityStore
 
+struct Transform
+{
+    glm::vec2 position;
+    glm::vec2 prevPosition; // position at the previous simulation tick, used to interpolate drawing
     float direction;
-    float maxSpeedX;
-
-    std::vector<Animation> animations;
-    int currentAnimation;
 
-    SDL_Texture *texture;
+    Transform() : position(0, 0), prevPosition(0, 0), direction(1) {}
+};
 
+struct PhysicsBody
+{
+    glm::vec2 velocity, acceleration;
+    float maxSpeedX;
     bool dynamic;
     bool grounded;
+    uint8_t padding[2] = {}; // see PlayerData
+
+    PhysicsBody() : velocity(0, 0), acceleration(0, 0), maxSpeedX(0), dynamic(false), grounded(false) {}
+};
 
-    SDL_FRect collider;
+// The clip has the image and frames, an entity only keeps its playhead
+using Sprite = AnimationPlayhead;
 
-    GameObject() : data{.level = LevelData()}, collider{0}
-    {
-        type = ObjectType::level;
-        position = velocity = acceleration = glm::vec2(0, 0);
-        direction = 1;
-        maxSpeedX = 0;
-        currentAnimation = -1;
-        texture = nullptr;
-        dynamic = false;
-        grounded = false;
-    }
+// Short-lived objects, kept in ObjectPools instead of the entity store
+
+struct Bullet
+{
+    glm::vec2 position, prevPosition, velocity;
+    AnimationPlayhead animation;
+    float age; // seconds since it was fired
+};
+
+struct Effect
+{
+    glm::vec2 position;
+    AnimationPlayhead animation; // a once clip, the effect is gone when it finishes
+    bool flipped;
+    uint8_t padding[3] = {}; // see PlayerData
 };
\ No newline at end of file
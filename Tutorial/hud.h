@@ -0,0 +1,202 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <array>
+#include <vector>
+#include <format>
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * Retained text layer for the HUD and debug read-outs. Labels are registered once and keep their
+ * text in fixed buffers; set() formats into a scratch buffer and leaves the label alone when the
+ * text comes out the same, and the quads of all labels are rebuilt only when one of them changed.
+ * SDL's debug font is drawn once into a glyph texture, so the whole layer goes out in a single
+ * SDL_RenderGeometry call.
+ * Nothing is allocated after the first draw.
+ */
+class Hud
+{
+public:
+    static const size_t MAX_LABELS = 32;
+    static const size_t LABEL_CAPACITY = 48; // characters, longer text is cut off
+    using Label = int;
+
+private:
+    static const int GLYPH_SIZE = SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE;
+    static const int GLYPH_COLUMNS = 16;
+    static const char FIRST_GLYPH = ' ';
+    static const char LAST_GLYPH = '~';
+    static const int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+    static const int GLYPH_ROWS = (GLYPH_COUNT + GLYPH_COLUMNS - 1) / GLYPH_COLUMNS;
+
+    struct Text
+    {
+        std::array<char, LABEL_CAPACITY> chars;
+        size_t length = 0;
+        SDL_FPoint position;
+        SDL_FColor color;
+        bool visible = true;
+    };
+
+    std::array<Text, MAX_LABELS> labels;
+    size_t labelCount = 0;
+    std::array<char, LABEL_CAPACITY> scratch; // set() formats here first
+    bool dirty = true; // quads have to be rebuilt
+
+    SDL_Texture *glyphs = nullptr;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    bool buildGlyphs(SDL_Renderer *renderer)
+    {
+        glyphs = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET,
+                                   GLYPH_COLUMNS * GLYPH_SIZE, GLYPH_ROWS * GLYPH_SIZE);
+        if (!glyphs)
+        {
+            SDL_Log("Could not create the HUD glyph texture: %s", SDL_GetError());
+            return false;
+        }
+        SDL_SetTextureScaleMode(glyphs, SDL_SCALEMODE_NEAREST);
+        SDL_SetTextureBlendMode(glyphs, SDL_BLENDMODE_BLEND);
+
+        // white glyphs, tinted per label through the vertex colour
+        SDL_Texture *previousTarget = SDL_GetRenderTarget(renderer);
+        SDL_SetRenderTarget(renderer, glyphs);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        for (int g = 0; g < GLYPH_COUNT; g++)
+        {
+            const char text[2] = {static_cast<char>(FIRST_GLYPH + g), '\0'};
+            SDL_RenderDebugText(renderer, static_cast<float>(g % GLYPH_COLUMNS * GLYPH_SIZE),
+                                static_cast<float>(g / GLYPH_COLUMNS * GLYPH_SIZE), text);
+        }
+        SDL_SetRenderTarget(renderer, previousTarget);
+        return true;
+    }
+
+    void buildQuads()
+    {
+        vertices.clear();
+        indices.clear();
+        const float u = 1.0f / GLYPH_COLUMNS;
+        const float v = 1.0f / GLYPH_ROWS;
+        for (size_t l = 0; l < labelCount; l++)
+        {
+            const Text &label = labels[l];
+            if (!label.visible)
+            {
+                continue;
+            }
+            for (size_t i = 0; i < label.length; i++)
+            {
+                char c = label.chars[i];
+                if (c == ' ')
+                {
+                    continue;
+                }
+                if (c < FIRST_GLYPH || c > LAST_GLYPH)
+                {
+                    c = '?';
+                }
+                const int g = c - FIRST_GLYPH;
+                const float x = label.position.x + i * GLYPH_SIZE, y = label.position.y;
+                const float s = (g % GLYPH_COLUMNS) * u, t = (g / GLYPH_COLUMNS) * v;
+
+                const int base = static_cast<int>(vertices.size());
+                vertices.push_back({{x, y}, label.color, {s, t}});
+                vertices.push_back({{x + GLYPH_SIZE, y}, label.color, {s + u, t}});
+                vertices.push_back({{x + GLYPH_SIZE, y + GLYPH_SIZE}, label.color, {s + u, t + v}});
+                vertices.push_back({{x, y + GLYPH_SIZE}, label.color, {s, t + v}});
+                for (int index : {0, 1, 2, 0, 2, 3})
+                {
+                    indices.push_back(base + index);
+                }
+            }
+        }
+        dirty = false;
+    }
+
+public:
+    Hud()
+    {
+        vertices.reserve(MAX_LABELS * LABEL_CAPACITY * 4);
+        indices.reserve(MAX_LABELS * LABEL_CAPACITY * 6);
+    }
+
+    ~Hud() { releaseGlyphs(); }
+
+    Hud(const Hud &) = delete;
+    Hud &operator=(const Hud &) = delete;
+
+    // Registers a label, once; -1 when all MAX_LABELS are taken
+    Label add(float x, float y, SDL_Color color)
+    {
+        if (labelCount == MAX_LABELS)
+        {
+            return -1;
+        }
+        Text &label = labels[labelCount];
+        label.position = {x, y};
+        label.color = {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f};
+        label.length = 0;
+        dirty = true;
+        return static_cast<Label>(labelCount++);
+    }
+
+    // Formats the label's text; the quads are only rebuilt when it differs from what the label shows
+    template <typename... Args>
+    void set(Label id, std::format_string<const Args &...> format, const Args &...args)
+    {
+        if (id < 0 || static_cast<size_t>(id) >= labelCount)
+        {
+            return;
+        }
+        Text &label = labels[id];
+        const size_t length = std::format_to_n(scratch.data(), LABEL_CAPACITY, format, args...).out - scratch.data();
+        if (length == label.length && std::equal(scratch.begin(), scratch.begin() + length, label.chars.begin()))
+        {
+            return;
+        }
+        std::copy(scratch.begin(), scratch.begin() + length, label.chars.begin());
+        label.length = length;
+        dirty = true;
+    }
+
+    void setVisible(Label id, bool visible)
+    {
+        if (id >= 0 && static_cast<size_t>(id) < labelCount && labels[id].visible != visible)
+        {
+            labels[id].visible = visible;
+            dirty = true;
+        }
+    }
+
+    // Draws every visible label, in logical coordinates
+    void draw(SDL_Renderer *renderer)
+    {
+        if (!glyphs && !buildGlyphs(renderer))
+        {
+            return;
+        }
+        if (dirty)
+        {
+            buildQuads();
+        }
+        if (!indices.empty())
+        {
+            SDL_RenderGeometry(renderer, glyphs, vertices.data(), static_cast<int>(vertices.size()),
+                               indices.data(), static_cast<int>(indices.size()));
+        }
+    }
+
+    // Drops the glyph texture, e.g. after the render targets were reset; it is redrawn when needed next
+    void releaseGlyphs()
+    {
+        if (glyphs)
+        {
+            SDL_DestroyTexture(glyphs);
+            glyphs = nullptr;
+        }
+    }
+};
@@ -0,0 +1,302 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+
+#include "mappedFile.h"
+
+/*
+ * Input journal, written with --record and played back with --replay. Little endian, laid out as:
+ *   JournalHeader
+ *   one record per simulation tick:
+ *     uint8 changeCount, uint8 eventCount
+ *     float tickLength, only when the header's tickLength is 0 (one tick per frame)
+ *     uint16 code[changeCount + eventCount]
+ * A code is a scancode, with JOURNAL_KEY_DOWN set for a press. Changes are the keys whose held state
+ * differs from the tick before, events the key presses and releases handled in this tick, so a tick
+ * where nothing happens takes two bytes.
+ */
+const char JOURNAL_MAGIC[4] = {'I', 'J', 'N', 'L'};
+const uint32_t JOURNAL_VERSION = 1;
+const uint16_t JOURNAL_KEY_DOWN = 0x8000;
+
+struct JournalHeader
+{
+    char magic[4];
+    uint32_t version;
+    float tickLength; // 0 when every tick stores its own
+    uint32_t columns;  // level width, replays only match on the same level
+    uint32_t entities; // entity count at the first tick
+    uint32_t tickCount;
+    uint64_t checksum; // of the simulation after the last tick
+};
+
+static_assert(sizeof(JournalHeader) == 32, "the journal header is written to disk as it is");
+
+/*
+ * Everything the simulation reads from the keyboard goes through here, one tick at a time. Live, the
+ * keys are a snapshot of the keyboard taken when the tick begins and the events are those queued since
+ * the tick before; both can be written to a journal. Replaying, both come from the journal instead and
+ * the keyboard is ignored, so the simulation sees exactly what it saw when recording.
+ */
+class InputJournal
+{
+    std::array<bool, SDL_SCANCODE_COUNT> keys{}; // held keys as the simulation sees them this tick
+    std::vector<uint16_t> pending;               // key events since the last tick
+    std::vector<uint16_t> events;                // key events of this tick
+    std::vector<uint16_t> changes;
+    const bool *source;                          // live keyboard state
+
+    JournalHeader header;
+    std::ofstream out;
+    std::vector<uint8_t> buffer; // records not written to the file yet
+    MappedFile replayFile;
+    size_t cursor = 0;
+    uint32_t tick = 0; // ticks begun so far
+
+    template <typename T>
+    void put(const T &value)
+    {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    bool take(T &value)
+    {
+        if (cursor + sizeof(T) > replayFile.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, replayFile.data() + cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    void flush()
+    {
+        out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+        buffer.clear();
+    }
+
+public:
+    InputJournal() : source(SDL_GetKeyboardState(nullptr)), header{}
+    {
+        pending.reserve(64);
+        events.reserve(64);
+        changes.reserve(64);
+        buffer.reserve(8192);
+    }
+
+    ~InputJournal() { close(0); }
+
+    InputJournal(const InputJournal &) = delete;
+    InputJournal &operator=(const InputJournal &) = delete;
+
+    // Keys read live, SDL's keyboard state unless something else (like a benchmark script) stands in for it
+    void setSource(const bool *keyboard) { source = keyboard; }
+
+    bool isRecording() const { return out.is_open(); }
+    bool isReplaying() const { return replayFile.isOpen(); }
+    const JournalHeader &getHeader() const { return header; }
+    uint32_t getTick() const { return tick; }
+
+    // The keys held this tick, what the simulation reads instead of the keyboard
+    const bool *getKeys() const { return keys.data(); }
+
+    // Starts writing every tick to a journal; tickLength 0 stores each tick's own length
+    bool record(const std::string &path, float tickLength, uint32_t columns, uint32_t entities)
+    {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        header = {};
+        std::memcpy(header.magic, JOURNAL_MAGIC, 4);
+        header.version = JOURNAL_VERSION;
+        header.tickLength = tickLength;
+        header.columns = columns;
+        header.entities = entities;
+        tick = 0;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header)); // rewritten by close()
+        return true;
+    }
+
+    bool replay(const std::string &path)
+    {
+        if (!replayFile.open(path.c_str()) || replayFile.size() < sizeof(JournalHeader))
+        {
+            replayFile.close();
+            return false;
+        }
+        std::memcpy(&header, replayFile.data(), sizeof(header));
+        if (std::memcmp(header.magic, JOURNAL_MAGIC, 4) != 0 || header.version != JOURNAL_VERSION)
+        {
+            SDL_Log("%s is not a version %u input journal", path.c_str(), JOURNAL_VERSION);
+            replayFile.close();
+            return false;
+        }
+        cursor = sizeof(JournalHeader);
+        tick = 0;
+        keys.fill(false);
+        return true;
+    }
+
+    // A key press or release from the event loop, handled at the start of the next tick; ignored while replaying
+    void queueKey(SDL_Scancode key, bool down)
+    {
+        if (!isReplaying() && pending.size() < UINT8_MAX)
+        {
+            pending.push_back(static_cast<uint16_t>(key | (down ? JOURNAL_KEY_DOWN : 0)));
+        }
+    }
+
+    /**
+     * @brief Takes the input of the next tick, from the keyboard or the journal.
+     * @param tickLength Length of the tick; recorded when the journal stores per tick lengths, replaced by the recorded one when replaying.
+     * @return False once a replay has run out of ticks.
+     */
+    bool beginTick(float &tickLength)
+    {
+        events.clear();
+        if (isReplaying())
+        {
+            uint8_t changeCount, eventCount;
+            if (tick == header.tickCount || !take(changeCount) || !take(eventCount) ||
+                (header.tickLength == 0 && !take(tickLength)))
+            {
+                return false;
+            }
+            if (header.tickLength > 0)
+            {
+                tickLength = header.tickLength;
+            }
+            for (int i = 0; i < changeCount + eventCount; i++)
+            {
+                uint16_t code;
+                if (!take(code) || (code & ~JOURNAL_KEY_DOWN) >= SDL_SCANCODE_COUNT)
+                {
+                    return false;
+                }
+                if (i < changeCount)
+                {
+                    keys[code & ~JOURNAL_KEY_DOWN] = (code & JOURNAL_KEY_DOWN) != 0;
+                }
+                else
+                {
+                    events.push_back(code);
+                }
+            }
+            tick++;
+            return true;
+        }
+
+        changes.clear();
+        for (size_t key = 0; key < keys.size(); key++)
+        {
+            if (keys[key] != source[key] && changes.size() < UINT8_MAX)
+            {
+                keys[key] = source[key];
+                changes.push_back(static_cast<uint16_t>(key | (keys[key] ? JOURNAL_KEY_DOWN : 0)));
+            }
+        }
+        events.swap(pending);
+
+        if (isRecording())
+        {
+            put(static_cast<uint8_t>(changes.size()));
+            put(static_cast<uint8_t>(events.size()));
+            if (header.tickLength == 0)
+            {
+                put(tickLength);
+            }
+            for (uint16_t code : changes)
+            {
+                put(code);
+            }
+            for (uint16_t code : events)
+            {
+                put(code);
+            }
+            if (buffer.size() >= 4096)
+            {
+                flush();
+            }
+        }
+        tick++;
+        return true;
+    }
+
+    // Calls onKey(key, down) for every key event of this tick, in the order they happened
+    template <typename Fn>
+    void forEachEvent(Fn &&onKey) const
+    {
+        for (uint16_t code : events)
+        {
+            onKey(static_cast<SDL_Scancode>(code & ~JOURNAL_KEY_DOWN), (code & JOURNAL_KEY_DOWN) != 0);
+        }
+    }
+
+    // Finishes a recording with the checksum of where the simulation ended up, or stops a replay
+    void close(uint64_t checksum)
+    {
+        if (isRecording())
+        {
+            flush();
+            header.tickCount = tick;
+            header.checksum = checksum;
+            out.seekp(0);
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.close();
+        }
+        replayFile.close();
+    }
+};
+
+/*
+ * Input on its way from the thread that pumps SDL's events to a simulation running on another thread.
+ * The event loop posts key events as they come and a copy of the keyboard once it has pumped them; the
+ * simulation collects both when it starts a frame, so it never reads SDL's keyboard state while the
+ * event loop is updating it.
+ */
+class InputMailbox
+{
+    std::mutex mutex;
+    std::array<bool, SDL_SCANCODE_COUNT> keyboard{};
+    std::vector<uint16_t> events;
+
+public:
+    InputMailbox() { events.reserve(64); }
+
+    void post(SDL_Scancode key, bool down)
+    {
+        std::lock_guard lock(mutex);
+        events.push_back(static_cast<uint16_t>(key | (down ? JOURNAL_KEY_DOWN : 0)));
+    }
+
+    void postKeyboard(const bool *state)
+    {
+        std::lock_guard lock(mutex);
+        std::copy(state, state + SDL_SCANCODE_COUNT, keyboard.begin());
+    }
+
+    // Queues the events posted since the last call on the journal and copies the keyboard into 'keys',
+    // which should be the journal's source
+    void collect(InputJournal &journal, std::array<bool, SDL_SCANCODE_COUNT> &keys)
+    {
+        std::lock_guard lock(mutex);
+        for (uint16_t code : events)
+        {
+            journal.queueKey(static_cast<SDL_Scancode>(code & ~JOURNAL_KEY_DOWN), (code & JOURNAL_KEY_DOWN) != 0);
+        }
+        events.clear();
+        keys = keyboard;
+    }
+};
@@ -0,0 +1,208 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+/*
+ * Thread pool with one job queue per thread. Threads take their own work from the back of
+ * their queue and, when it runs dry, steal from the front of the others', so uneven chunks
+ * spread out over the cores on their own. The thread calling parallelFor() works along
+ * with the pool instead of waiting idle.
+ */
+class JobSystem
+{
+    struct Batch
+    {
+        void (*invoke)(const void *fn, size_t begin, size_t end);
+        const void *fn;
+        std::atomic<size_t> remaining;
+    };
+
+    struct Job
+    {
+        Batch *batch;
+        size_t begin, end;
+    };
+
+    // A vector rather than a deque, which would allocate and free blocks every frame: stealing only moves
+    // the head forward, and the storage is reused once the queue has run empty
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::vector<Job> jobs;
+        size_t head = 0; // jobs before it were stolen
+
+        bool empty() const { return head == jobs.size(); }
+
+        void push(const Job &job)
+        {
+            if (empty())
+            {
+                jobs.clear();
+                head = 0;
+            }
+            jobs.push_back(job);
+        }
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues; // queue 0 belongs to the calling thread
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};
+    bool stopping = false;
+
+    bool pop(size_t self, Job &job)
+    {
+        {
+            WorkQueue &own = *queues[self];
+            std::lock_guard lock(own.mutex);
+            if (!own.empty())
+            {
+                job = own.jobs.back();
+                own.jobs.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++)
+        {
+            WorkQueue &victim = *queues[(self + i) % queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.empty())
+            {
+                job = victim.jobs[victim.head++];
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void run(const Job &job)
+    {
+        job.batch->invoke(job.batch->fn, job.begin, job.end);
+        job.batch->remaining.fetch_sub(1, std::memory_order_release);
+    }
+
+    void work(size_t self)
+    {
+        Job job;
+        while (true)
+        {
+            if (pop(self, job))
+            {
+                run(job);
+                continue;
+            }
+
+            std::unique_lock lock(sleepMutex);
+            wake.wait(lock, [this]
+                      { return stopping || queued > 0; });
+            if (stopping)
+            {
+                return;
+            }
+        }
+    }
+
+public:
+    // threadCount counts the calling thread too; 0 uses every core
+    JobSystem(int threadCount = 0)
+    {
+        if (threadCount <= 0)
+        {
+            threadCount = std::max(SDL_GetNumLogicalCPUCores(), 1);
+        }
+        for (int i = 0; i < threadCount; i++)
+        {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (int i = 1; i < threadCount; i++)
+        {
+            workers.emplace_back(&JobSystem::work, this, static_cast<size_t>(i));
+        }
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &t : workers)
+        {
+            t.join();
+        }
+    }
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    int getThreadCount() const { return static_cast<int>(queues.size()); }
+
+    /**
+     * @brief Calls fn(begin, end) for consecutive ranges of [0, count) in parallel and returns once all are done.
+     * @param count Number of items.
+     * @param grain Items per range. Ranges only depend on count and grain, never on the number of threads,
+     * so per-range results can be combined in a deterministic order.
+     * @param fn Called from any thread; ranges never overlap.
+     * Only one thread may be inside parallelFor() at a time.
+     */
+    template <typename Fn>
+    void parallelFor(size_t count, size_t grain, const Fn &fn)
+    {
+        grain = std::max<size_t>(grain, 1);
+        const size_t chunks = (count + grain - 1) / grain;
+        if (chunks <= 1 || queues.size() == 1)
+        {
+            for (size_t begin = 0; begin < count; begin += grain)
+            {
+                fn(begin, std::min(begin + grain, count));
+            }
+            return;
+        }
+
+        Batch batch;
+        batch.invoke = [](const void *f, size_t begin, size_t end)
+        { (*static_cast<const Fn *>(f))(begin, end); };
+        batch.fn = &fn;
+        batch.remaining = chunks;
+
+        // counted before they are pushed so 'queued' never drops below the real number of jobs
+        {
+            std::lock_guard lock(sleepMutex);
+            queued += chunks;
+        }
+
+        // deal the ranges out round robin, the thieves even out whatever imbalance is left
+        for (size_t c = 0; c < chunks; c++)
+        {
+            const size_t begin = c * grain;
+            WorkQueue &queue = *queues[c % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            queue.push({&batch, begin, std::min(begin + grain, count)});
+        }
+        wake.notify_all();
+
+        Job job;
+        while (batch.remaining.load(std::memory_order_acquire) > 0)
+        {
+            if (pop(0, job))
+            {
+                run(job);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
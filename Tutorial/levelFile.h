@@ -0,0 +1,190 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "mappedFile.h"
+#include "tileMap.h"
+
+/*
+ * Binary level written by tools/levelConverter.cpp. Little endian, laid out as:
+ *   LevelHeader
+ *   LevelChunk[chunkCount], the index, one entry per chunkColumns columns from left to right
+ *   LevelSpawn[enemyCount], the enemy markers from left to right
+ *   chunk cells, each chunk starting on a LEVEL_ALIGNMENT boundary
+ * A chunk is laid out exactly like a TileMap chunk (per layer, column by column, 'rows' tile IDs per
+ * column), so instantiating one is a single copy out of the mapping. The last chunk is padded with
+ * empty columns.
+ */
+const char LEVEL_MAGIC[4] = {'L', 'V', 'L', 'C'};
+const uint32_t LEVEL_VERSION = 2;
+const uint64_t LEVEL_ALIGNMENT = 16;
+
+struct LevelHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t rows, columns;
+    uint32_t chunkColumns, chunkCount;
+    int32_t spawnRow, spawnColumn; // the player's cell
+    uint32_t enemyCount;
+    uint32_t reserved;
+};
+
+struct LevelChunk
+{
+    uint64_t offset; // from the start of the file
+    uint32_t size;
+    uint32_t reserved;
+};
+
+// A marker cell, the tile map has an empty cell there
+struct LevelSpawn
+{
+    int32_t row, column;
+};
+
+static_assert(sizeof(LevelHeader) == 40 && sizeof(LevelChunk) == 16 && sizeof(LevelSpawn) == 8,
+              "level structs are written to disk as they are");
+
+/*
+ * Streams a level file into a TileMap. Opening only maps the file and checks the index; chunks are
+ * copied into the map as the view port comes within keepChunks of them and given back once it is
+ * more than a chunk further away, so the map holds the same few chunks however long the level is.
+ */
+class LevelFile
+{
+    MappedFile file;
+    LevelHeader header;
+    const LevelChunk *chunks;
+    const LevelSpawn *enemies;
+    int keepChunks;
+    int firstResident, lastResident; // resident chunks of the map, empty when last < first
+
+public:
+    LevelFile() : header{}, chunks(nullptr), enemies(nullptr), keepChunks(1), firstResident(0), lastResident(-1) {}
+
+    bool open(const char *path)
+    {
+        close();
+        if (!file.open(path) || file.size() < sizeof(LevelHeader))
+        {
+            file.close();
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        const uint64_t chunkSize = TILE_LAYER_COUNT * static_cast<uint64_t>(header.chunkColumns) * header.rows;
+        const uint64_t indexEnd = sizeof(LevelHeader) + static_cast<uint64_t>(header.chunkCount) * sizeof(LevelChunk) +
+                                  static_cast<uint64_t>(header.enemyCount) * sizeof(LevelSpawn);
+        bool valid = std::memcmp(header.magic, LEVEL_MAGIC, 4) == 0 && header.version == LEVEL_VERSION &&
+                     header.rows > 0 && header.chunkColumns > 0 &&
+                     header.chunkCount == (header.columns + header.chunkColumns - 1) / header.chunkColumns &&
+                     indexEnd <= file.size();
+        if (valid)
+        {
+            chunks = reinterpret_cast<const LevelChunk *>(file.data() + sizeof(LevelHeader));
+            enemies = reinterpret_cast<const LevelSpawn *>(chunks + header.chunkCount);
+            for (uint32_t i = 0; i < header.chunkCount && valid; i++)
+            {
+                valid = chunks[i].size == chunkSize && chunks[i].offset >= indexEnd &&
+                        chunks[i].offset + chunks[i].size <= file.size();
+            }
+        }
+        if (!valid)
+        {
+            SDL_Log("Level %s is not a version %u level file", path, LEVEL_VERSION);
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        file.close();
+        header = {};
+        chunks = nullptr;
+        enemies = nullptr;
+        firstResident = 0;
+        lastResident = -1;
+    }
+
+    bool isOpen() const { return file.isOpen(); }
+    const LevelHeader &getHeader() const { return header; }
+    const LevelSpawn *getEnemies() const { return enemies; }
+
+    // A cell straight out of the file, whether its chunk is resident or not
+    uint8_t tileAt(TileLayer layer, int row, int column) const
+    {
+        if (!isOpen() || row < 0 || row >= static_cast<int>(header.rows) || column < 0 || column >= static_cast<int>(header.columns))
+        {
+            return 0;
+        }
+        const uint64_t local = static_cast<uint64_t>(layer) * header.chunkColumns + column % header.chunkColumns;
+        return file.data()[chunks[column / header.chunkColumns].offset + local * header.rows + row];
+    }
+
+    /**
+     * @brief Sizes the map for this level, with room for the chunks around a view port but none resident yet.
+     * @param viewWidth Width of the view port the level is streamed around.
+     * @param keepChunks Chunks kept resident on either side of the view port.
+     */
+    void attach(TileMap &map, float tileSize, SDL_FPoint origin, float viewWidth, int keepChunks)
+    {
+        this->keepChunks = keepChunks;
+        const int visibleChunks = static_cast<int>(std::ceil(viewWidth / (header.chunkColumns * tileSize))) + 1;
+        // the view port's chunks, keepChunks on each side and one more on each side before they are released
+        map.resize(header.rows, header.columns, tileSize, origin, header.chunkColumns, visibleChunks + 2 * keepChunks + 2);
+        firstResident = 0;
+        lastResident = -1;
+    }
+
+    // Instantiates the chunks near the view port and releases the ones that fell far enough behind;
+    // onLoaded(firstColumn, lastColumn) is called with the columns of every chunk copied in
+    template <typename Fn>
+    void stream(TileMap &map, const SDL_FRect &viewPort, Fn onLoaded)
+    {
+        if (!isOpen() || header.chunkCount == 0)
+        {
+            return;
+        }
+        const int lastChunk = static_cast<int>(header.chunkCount) - 1;
+        const float chunkWidth = header.chunkColumns * map.getTileSize();
+        const float left = viewPort.x - map.getOrigin().x;
+        const int loadFirst = std::clamp(static_cast<int>(std::floor(left / chunkWidth)) - keepChunks, 0, lastChunk);
+        const int loadLast = std::clamp(static_cast<int>(std::floor((left + viewPort.w) / chunkWidth)) + keepChunks, 0, lastChunk);
+
+        // one chunk of slack on each side, so walking back and forth over a chunk edge does not reload it every time
+        int first = loadFirst, last = loadLast;
+        if (lastResident >= firstResident)
+        {
+            first = std::max(std::min(firstResident, loadFirst), loadFirst - 1);
+            last = std::min(std::max(lastResident, loadLast), loadLast + 1);
+        }
+
+        for (int c = firstResident; c <= lastResident; c++)
+        {
+            if (c < first || c > last)
+            {
+                map.releaseChunk(c);
+            }
+        }
+        for (int c = first; c <= last; c++)
+        {
+            if (!map.isResident(c))
+            {
+                if (uint8_t *cells = map.loadChunk(c))
+                {
+                    std::memcpy(cells, file.data() + chunks[c].offset, chunks[c].size);
+                    const int firstColumn = c * static_cast<int>(header.chunkColumns);
+                    onLoaded(firstColumn, std::min(firstColumn + static_cast<int>(header.chunkColumns), static_cast<int>(header.columns)) - 1);
+                }
+            }
+        }
+        firstResident = first;
+        lastResident = last;
+    }
+};
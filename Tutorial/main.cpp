@@ -5,9 +5,42 @@
 #include <vector>
 #include <string>
 #include <array>
+#include <algorithm>
 #include <format>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
 
 #include "gameObject.h"
+#include "entityStore.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "enemies.h"
+#include "tileMap.h"
+#include "levelFile.h"
+#include "levelData.h"
+#include "tileChunkCache.h"
+#include "parallax.h"
+#include "spriteBatch.h"
+#include "frameArena.h"
+#include "renderCommands.h"
+#include "framePipeline.h"
+#include "framePacer.h"
+#include "assetPack.h"
+#include "textureCache.h"
+#include "timestep.h"
+#include "asyncLoader.h"
+#include "allocTracker.h"
+#include "profiler.h"
+#include "bench.h"
+#include "jobSystem.h"
+#include "audioMixer.h"
+#include "objectPool.h"
+#include "hud.h"
+#include "inputJournal.h"
+#include "snapshot.h"
+#include "netplay.h"
 
 // Represents the core components of the SDL application state.
 struct SDLState
@@ -16,98 +49,362 @@ struct SDLState
     SDL_Event event;
     SDL_Renderer *renderer;
     int width, height, logical_width, logical_height;
-    const bool *keys;
-
-    SDLState() : keys(SDL_GetKeyboardState(nullptr)) {}
 };
 
-const size_t LAYER_IDX_LEVEL = 0;
-const size_t LAYER_IDX_CHARACTERS = 0;
-const int MAP_ROWS = 5;
-const int MAP_COLUMNS = 50;
 const int TILE_SIZE = 32;
+const float DEFAULT_TICK_RATE = 60;   // simulation ticks per second, override with --tick-rate (0 = one tick per frame)
+const int MAX_STEPS_PER_FRAME = 5;    // ticks simulated at most in one frame when catching up after a hitch
+const Uint64 LOAD_UPLOAD_BUDGET_NS = 4000000; // texture uploads per loading screen frame, so it keeps drawing at 60 fps or more
+const float FALLBACK_FRAME_RATE = 60;         // frame cap when neither --fps nor the display gives one
+const Sint32 IDLE_WAIT_MS = 100;              // longest wait for an event while paused or in the background
+
+// Level file written by 'make level', the built in level is used when it is missing
+const char *const LEVEL_PATH = "../Data/level1.lvl";
+const uint16_t NETPLAY_PORT = 7000;   // UDP port netplay listens on, override with --netplay-port
+const int NETPLAY_LATENCY_MS = 100;   // delay of the --netplay loopback link, override with --netplay-latency
+const float ROLLBACK_BUDGET_MS = 16;  // longest a benchmark rollback may take, one 60 Hz frame
+const int LEVEL_KEEP_CHUNKS = 2; // chunks streamed in ahead of the view port on either side
+
+// Sprite batch layers, drawn in this order
+const int BATCH_LAYER_BACKGROUND = 0;
+const int BATCH_LAYER_LEVEL = 1;
+const int BATCH_LAYER_OBJECTS = 2;
+const int BATCH_LAYER_FOREGROUND = 3;
+
+// Bullets and hit effects live in fixed pools, these never allocate once the game runs
+const size_t MAX_BULLETS = 1024;
+const size_t MAX_EFFECTS = 256;
+const float BULLET_SPEED = 600;
+const float BULLET_LIFETIME = 1.0f;
+const float SHOOT_INTERVAL = 0.1f;
+
+// Entities per job in the parallel simulation phases. Fixed, so results never depend on the thread count.
+const size_t SIM_GRAIN = 256;
+
+// Room reserved per body for the contacts, candidates and broadphase pairs of a tick, so a crowd forming late in a run does not grow them
+const size_t CONTACTS_PER_BODY = 8;
+const size_t CANDIDATES_PER_BODY = 64;
+
+// Obstacles a body can hit one after the other in a tick, e.g. the floor and then a wall while sliding along it
+const int MAX_SWEEP_HITS = 4;
+
+// Something an entity may be touching, found by the narrowphase and acted on in the resolve phase
+struct Contact
+{
+    int other;      // entity index, -1 for a level tile
+    SDL_FRect rect; // its bounds when the narrowphase ran
+};
+
+// Scratch space of one SIM_GRAIN sized range of entities, kept between ticks so the collision phases do not allocate
+struct SimChunk
+{
+    std::vector<int> candidates;
+    std::vector<Contact> contacts;
+    std::vector<std::pair<size_t, uint32_t>> events; // entity index and animation event
+    size_t candidatePairs = 0;
+
+    SimChunk()
+    {
+        candidates.reserve(CANDIDATES_PER_BODY);
+        contacts.reserve(SIM_GRAIN * CONTACTS_PER_BODY);
+        events.reserve(SIM_GRAIN);
+    }
+};
 
 struct GameState
 {
-    std::array<std::vector<GameObject>, 2> layers;
-    std::vector<GameObject> backgroundTiles;
-    std::vector<GameObject> foregroundTiles;
-    int playerIndex;
+    EntityStore entities;
+    TileMap tiles;
+    std::mutex tilesMutex;    // held while the level streams into the tile map and while chunk textures are built from it
+    LevelFile level;          // the streamed level, closed when the built in one is used
+
+    // Only used by the render stage, see drawFrame()
+    TileChunkCache tileCache; // static tile layers pre-rendered into chunk textures
+    ParallaxCompositor parallax;
+    SpriteBatch spriteBatch;  // tiles and objects are queued here and drawn together once per frame
+    FrameArena frameArena;    // scratch memory of one rendered frame, reset at the start of every frame
+
+    std::array<EntityHandle, MAX_PLAYERS> playerHandles;
+    size_t playerCount = 1;
+    size_t localPlayer = 0; // the one this machine controls, the camera and the sounds follow it
     SDL_FRect mapViewPort;
-    float bg2scroll, bg3scroll, bg4scroll;
-
-    GameState(const SDLState &state)
+    Broadphase broadphase; // body ids are dense entity indices
+    ObjectPool<Bullet> bullets;
+    ObjectPool<Effect> effects;
+    EnemySystem enemies;
+
+    JobSystem jobs;
+    std::vector<SDL_FRect> sweptBounds;
+    std::vector<SimChunk> simChunks;
+    std::vector<uint32_t> contactBegin, contactEnd; // contacts of each entity in its chunk
+
+    GameState(const SDLState &state, int threads)
+        : bullets(MAX_BULLETS), effects(MAX_EFFECTS), jobs(threads)
     {
-        playerIndex = -1;
         mapViewPort = {
             .x = 0,
             .y = 0,
             .w = static_cast<float>(state.logical_width),
             .h = static_cast<float>(state.logical_height)};
-        bg2scroll = bg3scroll = bg4scroll = 0;
     }
 
-    GameObject &player() { return layers[LAYER_IDX_CHARACTERS][playerIndex]; }
+    // Dense index of a player, looked up through its handle so it stays right when other entities are removed
+    size_t player(size_t number = 0) const { return entities.indexOf(playerHandles[number]); }
+};
+
+// Rollback netplay against a second player, see --netplay
+struct Netplay
+{
+    NetLink link;
+    RollbackSession session;
+
+    // With --netplay loopback the other player is a second simulation in this process, played by the
+    // benchmark's input script and reached through a loopback link; null otherwise
+    std::unique_ptr<GameState> peerState;
+    NetLink peerLink;
+    std::unique_ptr<RollbackSession> peerSession;
+    BenchInput peerScript;
+
+    Netplay(size_t localPlayer) : session(link, localPlayer) {}
+};
+
+// What the simulation stage hands to the render stage for one frame
+struct FrameRecord
+{
+    RenderCommandBuffer commands;
+    int playerState = 0;
+    BroadphaseStats broadphase;
+    RollbackStats netplay;
+    bool finished = false; // the simulation ended with this frame, a replay ran out of ticks
+};
+
+// What the simulation stage keeps from one frame to the next
+struct SimulationStage
+{
+    FixedTimestep timestep;
+    float frameScale; // simulated seconds per second, above 1 for a fast replay
+    Uint64 prevTime;
+    std::array<bool, SDL_SCANCODE_COUNT> keys{}; // the keyboard as the event loop last handed it over
+    std::atomic<bool> paused{false};             // set by the event loop; time passes but no ticks run
+    Netplay *netplay = nullptr;                  // ticks go through its rollback session when set
 };
 
+// Asset IDs, named by the image's path below Data/ without extension
+const uint32_t ASSET_BRICK = assetId("tiles/brick");
+const uint32_t ASSET_GRASS = assetId("tiles/grass");
+const uint32_t ASSET_GROUND = assetId("tiles/ground");
+const uint32_t ASSET_PANEL = assetId("tiles/panel");
+const uint32_t ASSET_SOUND_SHOOT = assetId("audio/shoot");
+const uint32_t ASSET_SOUND_SHOOT_HIT = assetId("audio/shoot_hit");
+const uint32_t ASSET_SOUND_WALL_HIT = assetId("audio/wall_hit");
+const uint32_t ASSET_SOUND_ENEMY_HIT = assetId("audio/enemy_hit");
+const uint32_t ASSET_SOUND_MONSTER_DIE = assetId("audio/monster_die");
+
+// Decoded from the MP3 next to it by 'make music'; without it the game runs without music
+const char *const MUSIC_PATH = "../Data/audio/Juhani Junkala [Retro Game Music Pack] Level 1.wav";
+
+// Built with 'make pack'; without it every image is loaded from its own PNG
+const char *const ASSET_PACK_PATH = "../Data/assets.pak";
+const size_t TEXTURE_BUDGET_MB = 64;      // texture memory kept resident, override with --texture-budget
+const uint64_t TEXTURE_IDLE_FRAMES = 120; // frames a texture goes unused before it may be evicted
+
+// Frames, timing and events of every animation
+const char *const ANIMATIONS_PATH = "../Data/animations.txt";
+const uint32_t ANIM_EVENT_FOOTSTEP = assetId("footstep");
+
+// Background layers and how they scroll
+const char *const PARALLAX_PATH = "../Data/parallax.txt";
+
 struct Resources
 {
-    const int ANIM_PLAYER_IDLE = 0;
-    const int ANIM_PLAYER_RUN = 1;
-    const int ANIM_PLAYER_SLIDE = 2;
-    std::vector<Animation> playerAnims;
+    AnimationLibrary animations;
+    // Clips the code asks for by name, NO_CLIP when the library lacks them
+    uint16_t clipPlayerIdle, clipPlayerRun, clipPlayerSlide, clipBullet, clipBulletHit;
+    uint16_t clipEnemy, clipEnemyHit, clipEnemyDie;
+
+    // Every image and atlas page; only the render stage resolves handles through it
+    TextureCache textureCache{TEXTURE_BUDGET_MB << 20, TEXTURE_IDLE_FRAMES};
+    AssetPack pack;
+
+    // Fallback when there is no pack: one texture per image
+    std::vector<std::pair<uint32_t, AtlasRegion>> looseImages;
 
-    std::vector<SDL_Texture *> textures;
-    SDL_Texture *idle_texture, *run_texture, *brick, *grass, *ground, *panel, *sliding_texture, *background1, *background2, *background3, *background4;
+    std::vector<std::pair<uint32_t, DecodedAudio>> sounds; // until they are handed to the mixer
+
+    // Assets queued on the loader, collected by finishLoad(); images by asset name
+    std::vector<std::pair<std::string, AsyncLoader::Handle>> pendingImages;
+    std::vector<std::pair<uint32_t, AsyncLoader::Handle>> pendingSounds;
+
+    // Loads a loose image again after the texture cache evicted it
+    static TextureCache::Loader imageLoader(const std::string &name)
+    {
+        return [path = std::format("../Data/{}.png", name)](SDL_Renderer *renderer)
+        {
+            SDL_Texture *tex = IMG_LoadTexture(renderer, path.c_str());
+            if (!tex)
+            {
+                SDL_Log("Could not load %s: %s", path.c_str(), SDL_GetError());
+                return tex;
+            }
+            SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
+            return tex;
+        };
+    }
 
-    SDL_Texture *load_texture(SDL_Renderer *renderer, const std::string &filepath)
+    // Uploads the pack right away and queues everything else on the loader; false without the animation clips
+    bool load(SDLState &state, AsyncLoader &loader)
     {
-        // Load game asset
-        SDL_Texture *tex = IMG_LoadTexture(renderer, filepath.c_str());
-        SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
-        textures.push_back(tex);
-        return tex;
+        if (!animations.load(ANIMATIONS_PATH))
+        {
+            SDL_Log("Could not load the animations from %s", ANIMATIONS_PATH);
+            return false;
+        }
+        clipPlayerIdle = animations.find("player_idle");
+        clipPlayerRun = animations.find("player_run");
+        clipPlayerSlide = animations.find("player_slide");
+        clipBullet = animations.find("bullet");
+        clipBulletHit = animations.find("bullet_hit");
+        clipEnemy = animations.find("enemy");
+        clipEnemyHit = animations.find("enemy_hit");
+        clipEnemyDie = animations.find("enemy_die");
+
+        for (const char *name : {"audio/shoot", "audio/shoot_hit", "audio/wall_hit", "audio/enemy_hit", "audio/monster_die"})
+        {
+            pendingSounds.push_back({assetId(name), loader.loadAudio(std::format("../Data/{}.wav", name))});
+        }
+
+        if (pack.load(state.renderer, textureCache, ASSET_PACK_PATH))
+        {
+            std::cout << "Loaded " << pack.getPageCount() << " atlas page(s) from " << ASSET_PACK_PATH << std::endl;
+            return true;
+        }
+
+        std::cout << "No asset pack, loading images one by one" << std::endl;
+        for (const char *name : {"tiles/brick", "tiles/grass", "tiles/ground", "tiles/panel",
+                                 "bg/bg_layer1", "bg/bg_layer2", "bg/bg_layer3", "bg/bg_layer4"})
+        {
+            pendingImages.push_back({name, loader.loadImage(std::format("../Data/{}.png", name))});
+        }
+        // and the sprite sheets the animation clips use, each once
+        for (const AnimationClip &clip : animations.getClips())
+        {
+            if (std::none_of(pendingImages.begin(), pendingImages.end(), [&clip](const auto &image)
+                             { return image.first == clip.image; }))
+            {
+                pendingImages.push_back({clip.image, loader.loadImage(std::format("../Data/{}.png", clip.image))});
+            }
+        }
+        return true;
     }
 
-    void load(SDLState &state)
+    // Takes over what the loader produced, once it is done
+    void finishLoad(AsyncLoader &loader)
     {
-        playerAnims.resize(5);
-        playerAnims[ANIM_PLAYER_IDLE] = Animation(8, 1.6f);
-        playerAnims[ANIM_PLAYER_RUN] = Animation(4, 0.5f);
-        playerAnims[ANIM_PLAYER_SLIDE] = Animation(1, 1.0f);
+        for (const auto &[name, handle] : pendingImages)
+        {
+            if (SDL_Texture *tex = loader.takeTexture(handle))
+            {
+                const SDL_FRect rect{0, 0, static_cast<float>(tex->w), static_cast<float>(tex->h)};
+                looseImages.push_back({assetId(name), AtlasRegion{textureCache.add(imageLoader(name), tex), rect}});
+            }
+        }
+        for (const auto &[id, handle] : pendingSounds)
+        {
+            if (loader.getState(handle) == AssetState::ready)
+            {
+                sounds.push_back({id, loader.takeAudio(handle)});
+            }
+        }
+        pendingImages.clear();
+        pendingSounds.clear();
+
+        animations.resolve([this](const std::string &image) -> const AtlasRegion &
+                           { return get(assetId(image)); });
+    }
 
-        idle_texture = load_texture(state.renderer, "../data/idle.png");
-        run_texture = load_texture(state.renderer, "../data/run.png");
-        sliding_texture = load_texture(state.renderer, "../data/slide.png");
-        brick = load_texture(state.renderer, "../data/tiles/brick.png");
-        grass = load_texture(state.renderer, "../data/tiles/grass.png");
-        ground = load_texture(state.renderer, "../data/tiles/ground.png");
-        panel = load_texture(state.renderer, "../data/tiles/panel.png");
-        background1 = load_texture(state.renderer, "../data/bg/bg_layer1.png");
-        background2 = load_texture(state.renderer, "../data/bg/bg_layer2.png");
-        background3 = load_texture(state.renderer, "../data/bg/bg_layer3.png");
-        background4 = load_texture(state.renderer, "../data/bg/bg_layer4.png");
+    // Region of an image by asset ID; an empty region (invalid texture handle) if it is missing
+    const AtlasRegion &get(uint32_t id) const
+    {
+        static const AtlasRegion missing;
+        if (const AtlasRegion *region = pack.find(id))
+        {
+            return *region;
+        }
+        for (const auto &[looseId, region] : looseImages)
+        {
+            if (looseId == id)
+            {
+                return region;
+            }
+        }
+        return missing;
     }
 
     void unload()
     {
-        for (SDL_Texture *tex : textures)
+        pack.unload(textureCache);
+        for (const auto &[id, region] : looseImages)
         {
-            SDL_DestroyTexture(tex);
+            textureCache.release(region.texture);
         }
+        looseImages.clear();
+        textureCache.clear();
+        sounds.clear();
     }
 };
 
 // Function prototypes
 void cleanup(SDLState &state);
 bool initialise(SDLState &state);
-void drawObject(const SDLState &state, GameState &gs, GameObject &obj, float deltaTime);
-void update(const SDLState &state, GameState &gs, GameObject &obj, const Resources &res, float deltaTime);
-void collisionResponse(const SDLState &state, GameState &gs, const Resources &res, const SDL_FRect &rectA, const SDL_FRect &rectB, const SDL_FRect &rectC, GameObject &a, GameObject &b, float deltaTime);
-void checkCollision(const SDLState &state, GameState &gs, const Resources &res, GameObject &a, GameObject &b, float deltaTime);
-void createTiles(const SDLState &state, GameState &gs, const Resources &res);
-void handleKeyInput(const SDLState &state, GameState &gs, GameObject &obj, SDL_Scancode key, bool keyDown);
-void drawParralaxBackground(SDL_Renderer *renderer, SDL_Texture *texture, float xVelocity, float &scrollPos, float scrollFactor, float deltaTime);
+bool runLoadingScreen(SDLState &state, AsyncLoader &loader);
+void drawObject(const GameState &gs, const Resources &res, RenderCommandBuffer &commands, size_t index, float alpha);
+void recordFrame(GameState &gs, const Resources &res, float alpha, RenderCommandBuffer &commands);
+void drawFrame(const SDLState &state, GameState &gs, Resources &res, const RenderCommandBuffer &commands);
+bool simulateFrame(const SDLState &state, GameState &gs, const Resources &res, AudioMixer &audio, InputJournal &input, InputMailbox &mailbox, SimulationStage &stage, FrameRecord &frame);
+int runBenchmark(SDLState &state, GameState &gs, Resources &res, AudioMixer &audio, InputJournal &input, const BenchConfig &config);
+void simulate(const SDLState &state, GameState &gs, const Resources &res, const PlayerInput *inputs, float deltaTime);
+void playTickSounds(const GameState &gs, AudioMixer &audio, bool wasGrounded);
+bool simulateTick(const SDLState &state, GameState &gs, const Resources &res, InputJournal &input, float tickLength);
+void simulateInputs(const SDLState &state, GameState &gs, const Resources &res, const PlayerInput *inputs, float tickLength);
+PlayerInput readPlayerInput(const InputJournal &input);
+void saveSimulation(const GameState &gs, Snapshot &snapshot);
+void loadSimulation(GameState &gs, Snapshot &snapshot);
+std::unique_ptr<Netplay> startNetplay(const SDLState &state, GameState &gs, const Resources &res, const std::string &peer, uint16_t port, size_t player, int latencyMs);
+bool advanceNetplay(const SDLState &state, GameState &gs, const Resources &res, InputJournal &input, Netplay &netplay, float tickLength);
+int runReplay(const SDLState &state, GameState &gs, const Resources &res, InputJournal &input);
+uint64_t simulationChecksum(const GameState &gs);
+void streamLevel(GameState &gs);
+SDL_FRect simulationView(const GameState &gs);
+void update(GameState &gs, size_t index, const Resources &res, PlayerInput input, float deltaTime);
+void integrate(GameState &gs, float deltaTime);
+void updateProjectiles(GameState &gs, const Resources &res, float deltaTime);
+void drawProjectiles(const GameState &gs, const Resources &res, RenderCommandBuffer &commands, float alpha);
+void drawEnemies(const GameState &gs, const Resources &res, RenderCommandBuffer &commands, float alpha);
+void resolveCollisions(const SDLState &state, GameState &gs, size_t index, const Resources &res, float deltaTime);
+bool collisionResponse(const SDLState &state, GameState &gs, const Resources &res, const ContactManifold &manifold, size_t a, size_t b, float deltaTime);
+bool checkCollision(const SDLState &state, GameState &gs, const Resources &res, size_t a, const Contact &contact, ContactManifold &manifold, float deltaTime);
+void separateBodies(Transform &transform, PhysicsBody &body, const ContactManifold &manifold);
+void drawTileLayer(const GameState &gs, RenderCommandBuffer &commands, TileLayer layer, int batchLayer);
+void createTiles(const SDLState &state, GameState &gs, const Resources &res, int columns, const char *levelPath);
+EntityHandle createPlayer(GameState &gs, const Resources &res, uint8_t number, glm::vec2 position);
+bool isLevelSolid(const GameState &gs, int row, int column);
+void updateBroadphase(GameState &gs);
+void findContacts(GameState &gs);
+SDL_FRect getBounds(const EntityStore &entities, size_t index);
+void handleKeyInput(const SDLState &state, GameState &gs, size_t index, SDL_Scancode key, bool keyDown);
+
+// The simulation as a RollbackSession steps it: one game state, ticked through simulateInputs()
+struct NetplayGame
+{
+    const SDLState &state;
+    GameState &gs;
+    const Resources &res;
+    float tickLength;
+
+    void save(Snapshot &snapshot) const { saveSimulation(gs, snapshot); }
+    void load(Snapshot &snapshot) const { loadSimulation(gs, snapshot); }
+    void step(const PlayerInput *inputs) const { simulateInputs(state, gs, res, inputs, tickLength); }
+};
 
 int main(int argc, char *argv[])
 {
@@ -120,36 +417,298 @@ int main(int argc, char *argv[])
     state.logical_width = 640;
     state.logical_height = 360;
 
+    // --bench runs a fixed number of frames without a display and reports the timings
+    BenchConfig bench;
+    bench.parse(argc, argv);
+    if (bench.enabled)
+    {
+        // these only set defaults, SDL_VIDEO_DRIVER and SDL_RENDER_DRIVER in the environment still win
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen,dummy");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        SDL_SetHint(SDL_HINT_AUDIO_DRIVER, "dummy");
+    }
+
     // Initialise SDL, the window, and the renderer.
     if (!initialise(state))
     {
         return 1;
     }
 
+    // --- LOADING ---
+    // Files are decoded on worker threads while the loading screen uploads them and shows progress.
+    // --texture-budget sets the texture memory in MB, before anything is uploaded
     Resources res;
-    res.load(state);
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) == "--texture-budget")
+        {
+            res.textureCache.setBudget(static_cast<size_t>(std::max(std::atoi(argv[++i]), 1)) << 20);
+        }
+    }
+    {
+        AsyncLoader loader;
+        if (!res.load(state, loader))
+        {
+            res.unload();
+            cleanup(state);
+            return 1;
+        }
+        if (!runLoadingScreen(state, loader))
+        {
+            res.unload();
+            cleanup(state);
+            return 0;
+        }
+        res.finishLoad(loader);
+    }
+
+    // --- AUDIO ---
+    // The sounds were decoded while loading, the mixer converts them once into its own pool
+    AudioMixer audio;
+    if (audio.open())
+    {
+        for (const auto &[id, sound] : res.sounds)
+        {
+            audio.addSound(id, sound);
+        }
+        audio.playMusic(MUSIC_PATH);
+    }
+    res.sounds.clear();
+
+    // --- SIMULATION RATE ---
+    float tickRate = DEFAULT_TICK_RATE;
+    int threads = 0; // simulation threads, 0 uses every core
+    // the benchmark only streams a level file when given one, so its runs do not depend on what is in Data/
+    std::string levelPath = bench.enabled ? "" : LEVEL_PATH;
+    // --record writes the input of every tick to a journal, --replay plays one back instead of the keyboard,
+    // faster with --replay-speed or as fast as possible and without a picture with --no-render
+    std::string recordPath, replayPath;
+    float replaySpeed = 1;
+    bool render = true;
+    // --serial runs the simulation and render stages one after the other on this thread instead of pipelining them
+    bool serial = false;
+    // --pacing vsync, cap or unbounded; --fps sets the cap, by default the display's refresh rate
+    PacingMode pacing = PacingMode::vsync;
+    float frameRate = 0;
+    // --netplay <host>:<port> plays against another instance over UDP, listening on --netplay-port; --netplay loopback
+    // plays against a scripted second player in this process, over a link with --netplay-latency ms of delay.
+    // --netplay-player 1 makes this side the second player, the other side has to be the first
+    std::string netplayPeer;
+    uint16_t netplayPort = NETPLAY_PORT;
+    size_t netplayPlayer = 0;
+    int netplayLatency = NETPLAY_LATENCY_MS;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--tick-rate" && i + 1 < argc)
+        {
+            tickRate = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--level" && i + 1 < argc)
+        {
+            levelPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--record" && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--replay-speed" && i + 1 < argc)
+        {
+            replaySpeed = std::max(std::strtof(argv[++i], nullptr), 0.01f);
+        }
+        else if (std::string(argv[i]) == "--no-render")
+        {
+            render = false;
+        }
+        else if (std::string(argv[i]) == "--serial")
+        {
+            serial = true;
+        }
+        else if (std::string(argv[i]) == "--pacing" && i + 1 < argc)
+        {
+            if (!parsePacingMode(argv[++i], pacing))
+            {
+                std::cout << "Unknown pacing mode " << argv[i] << ", use vsync, cap or unbounded" << std::endl;
+            }
+        }
+        else if (std::string(argv[i]) == "--fps" && i + 1 < argc)
+        {
+            frameRate = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::string(argv[i]) == "--netplay" && i + 1 < argc)
+        {
+            netplayPeer = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--netplay-port" && i + 1 < argc)
+        {
+            netplayPort = static_cast<uint16_t>(std::atoi(argv[++i]));
+        }
+        else if (std::string(argv[i]) == "--netplay-player" && i + 1 < argc)
+        {
+            netplayPlayer = std::atoi(argv[++i]) == 1 ? 1 : 0;
+        }
+        else if (std::string(argv[i]) == "--netplay-latency" && i + 1 < argc)
+        {
+            netplayLatency = std::max(std::atoi(argv[++i]), 0);
+        }
+    }
+    if (!netplayPeer.empty() && (bench.enabled || !recordPath.empty() || !replayPath.empty() || tickRate <= 0))
+    {
+        std::cout << "--netplay needs a fixed --tick-rate and cannot be combined with --bench, --record or --replay" << std::endl;
+        netplayPeer.clear();
+    }
+    // both players collide with the tiles around them wherever they are, so netplay plays the built in level,
+    // which is resident in full, rather than one streamed around a single view port
+    if (!netplayPeer.empty())
+    {
+        levelPath.clear();
+    }
 
     // --- GAME DATA ---
-    GameState gs(state);
-    createTiles(state, gs, res);
+    GameState gs(state, threads);
+    createTiles(state, gs, res, bench.columns > 0 ? bench.columns : MAP_COLUMNS, levelPath.c_str());
+    if (gs.parallax.load(PARALLAX_PATH))
+    {
+        gs.parallax.resolve([&res](const std::string &image) -> const AtlasRegion &
+                            { return res.get(assetId(image)); });
+        std::cout << "Background: " << gs.parallax.getLayerCount() << " layers in " << gs.parallax.getStripCount() << " strips" << std::endl;
+    }
+
+    // --- INPUT ---
+    // The simulation reads the keyboard only through the journal, one snapshot per tick
+    InputJournal input;
+    if (!replayPath.empty())
+    {
+        if (!input.replay(replayPath))
+        {
+            std::cout << "Could not read input journal " << replayPath << std::endl;
+            gs.tileCache.releaseAll();
+            gs.parallax.releaseAll();
+            res.unload();
+            cleanup(state);
+            return 1;
+        }
+        const JournalHeader &journal = input.getHeader();
+        if (journal.columns != static_cast<uint32_t>(gs.tiles.getColumns()) || journal.entities != gs.entities.size())
+        {
+            std::cout << "The journal was recorded on another level, the replay will not match" << std::endl;
+        }
+        // a replay runs at the tick rate it was recorded at
+        tickRate = journal.tickLength > 0 ? 1.0f / journal.tickLength : 0;
+        std::cout << "Replaying " << journal.tickCount << " ticks from " << replayPath << std::endl;
+    }
+    else if (!recordPath.empty() &&
+             !input.record(recordPath, tickRate > 0 ? 1.0f / tickRate : 0, gs.tiles.getColumns(), static_cast<uint32_t>(gs.entities.size())))
+    {
+        std::cout << "Could not write input journal " << recordPath << std::endl;
+    }
+
+    if (bench.enabled || (!render && input.isReplaying()))
+    {
+        const int result = bench.enabled ? runBenchmark(state, gs, res, audio, input, bench) : runReplay(state, gs, res, input);
+        input.close(simulationChecksum(gs));
+        audio.close();
+        gs.tileCache.releaseAll();
+        gs.parallax.releaseAll();
+        res.unload();
+        cleanup(state);
+        return result;
+    }
+
+    // --- NETPLAY ---
+    std::unique_ptr<Netplay> netplay;
+    if (!netplayPeer.empty())
+    {
+        netplay = startNetplay(state, gs, res, netplayPeer, netplayPort, netplayPlayer, netplayLatency);
+    }
+
+    // a fast replay may need more ticks per frame than a hitch is allowed to catch up on
+    const float frameScale = input.isReplaying() ? replaySpeed : 1.0f;
+    SimulationStage stage{
+        .timestep = FixedTimestep(tickRate, MAX_STEPS_PER_FRAME * std::max(1, static_cast<int>(std::ceil(frameScale)))),
+        .frameScale = frameScale,
+        .prevTime = SDL_GetTicksNS()};
+    stage.netplay = netplay.get();
+
+    // --- FRAME PIPELINE ---
+    // The simulation stage runs on its own thread: it takes the input this loop posts, simulates and records
+    // each frame into a command buffer. This loop is the render stage, it draws and presents the recorded
+    // frames while the next ones are simulated, so a frame takes as long as the slower stage, not both.
+    // Profiling is per thread, the overlay and F4 show the render stage unless it runs with --serial.
+    InputMailbox mailbox;
+    input.setSource(stage.keys.data());
+    FramePipeline<FrameRecord> pipeline;
+    std::thread simulation;
+    if (!serial)
+    {
+        simulation = std::thread([&]()
+                                 {
+            while (FrameRecord *frame = pipeline.beginProduce())
+            {
+                const bool more = simulateFrame(state, gs, res, audio, input, mailbox, stage, *frame);
+                PROFILE_END_FRAME();
+                pipeline.endProduce();
+                if (!more)
+                {
+                    break;
+                }
+            } });
+    }
+
+    // --- FRAME PACING ---
+    if (frameRate <= 0)
+    {
+        const SDL_DisplayMode *display = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(state.window));
+        frameRate = display && display->refresh_rate > 0 ? display->refresh_rate : FALLBACK_FRAME_RATE;
+    }
+    FramePacer pacer;
+    pacer.setMode(state.renderer, pacing, frameRate);
+    // paused with P; in the background or minimised the loop waits for events instead of polling
+    bool paused = false, focused = true, minimised = false;
 
     // --- DELTA TIME SETUP ---
-    // Get the time at the start of the game.
-    uint64_t prevTime = SDL_GetTicks();
+    pacer.beginFrame();
     float fps_timer = 0;
     int fps_counter = 0;
     int last_fps = 0;
+#if PROFILER_ENABLED
+    bool showProfiler = false; // F3 toggles the profiler overlay, F4 writes the captured frames to disk
+#endif
+
+    // Debug read-outs, registered once and only reformatted when their values change
+    Hud hud;
+    const Hud::Label stateLabel = hud.add(5, 5, SDL_Color{255, 255, 255, 255});
+    const Hud::Label fpsLabel = hud.add(state.logical_width - 70.0f, 0, SDL_Color{0, 255, 0, 255});
+    // candidate pairs tested this frame against what checking every object with every other would cost
+    const Hud::Label pairsLabel = hud.add(state.logical_width - 150.0f, 10, SDL_Color{0, 255, 0, 255});
+    const Hud::Label batchesLabel = hud.add(state.logical_width - 150.0f, 20, SDL_Color{0, 255, 0, 255});
+    const Hud::Label audioLabel = hud.add(state.logical_width - 150.0f, 30, SDL_Color{0, 255, 0, 255});
+    // average frame length and its standard deviation over the last FramePacer::STATS_FRAMES frames
+    const Hud::Label frameLabel = hud.add(state.logical_width - 150.0f, 40, SDL_Color{0, 255, 0, 255});
+    // resident texture memory, and how often the cache had to load and evict
+    const Hud::Label texturesLabel = hud.add(state.logical_width - 150.0f, 50, SDL_Color{0, 255, 0, 255});
+    // netplay: ticks rolled back last time and how long that took, ticks spent waiting and desyncs seen
+    const Hud::Label netplayLabel = hud.add(state.logical_width - 150.0f, 60, SDL_Color{0, 255, 0, 255});
+    hud.setVisible(netplayLabel, netplay != nullptr);
+    const Hud::Label pausedLabel = hud.add(state.logical_width / 2 - 24.0f, state.logical_height / 2 - 4.0f, SDL_Color{255, 255, 255, 255});
+    hud.set(pausedLabel, "PAUSED");
 
     // Start the main game loop.
     bool running = true;
     while (running)
     {
         // --- DELTA TIME CALCULATION ---
-        // Get the current time at the beginning of the frame.
-        uint64_t nowTime = SDL_GetTicks();
-        // Calculate the time elapsed since the last frame, in seconds.
-        // We use 1000.0f to force a floating-point division.
-        float deltaTime = (nowTime - prevTime) / 1000.0f;
+        // The time elapsed since the last frame, in seconds, measured in nanoseconds.
+        const float deltaTime = pacer.beginFrame();
+        // everything the last frame took from the arena is given back at once
+        gs.frameArena.reset();
 
         // --- FPS Averaging Logic ---
         fps_timer += deltaTime;
@@ -162,102 +721,148 @@ int main(int argc, char *argv[])
         }
 
         // Process all pending events in the queue.
-        while (SDL_PollEvent(&state.event))
-        {
-            switch (state.event.type)
-            {
-            case SDL_EVENT_QUIT:
-                std::cout << "User clicked on the close window button" << std::endl;
-                running = false;
-                break;
-            case SDL_EVENT_WINDOW_RESIZED:
-                state.width = state.event.window.data1;
-                state.height = state.event.window.data2;
-                break;
-            case SDL_EVENT_KEY_DOWN:
-                handleKeyInput(state, gs, gs.player(), state.event.key.scancode, true);
-                break;
-            case SDL_EVENT_KEY_UP:
-                handleKeyInput(state, gs, gs.player(), state.event.key.scancode, false);
-                break;
-            }
-        }
-
-        // Update all objects
-        for (auto &layer : gs.layers)
         {
-            for (GameObject &obj : layer)
+            PROFILE_SCOPE(ProfilePhase::events);
+            // when idle, sleep until something happens (or a while has passed) instead of spinning
+            const bool idle = paused || !focused || minimised;
+            for (bool pending = idle ? SDL_WaitEventTimeout(&state.event, IDLE_WAIT_MS) : SDL_PollEvent(&state.event);
+                 pending; pending = SDL_PollEvent(&state.event))
             {
-                update(state, gs, obj, res, deltaTime);
-                if (obj.currentAnimation != -1)
+                switch (state.event.type)
                 {
-                    obj.animations[obj.currentAnimation].step(deltaTime);
+                case SDL_EVENT_QUIT:
+                    std::cout << "User clicked on the close window button" << std::endl;
+                    running = false;
+                    break;
+                case SDL_EVENT_WINDOW_RESIZED:
+                    state.width = state.event.window.data1;
+                    state.height = state.event.window.data2;
+                    break;
+                case SDL_EVENT_WINDOW_FOCUS_GAINED:
+                case SDL_EVENT_WINDOW_FOCUS_LOST:
+                    focused = state.event.type == SDL_EVENT_WINDOW_FOCUS_GAINED;
+                    break;
+                case SDL_EVENT_WINDOW_MINIMIZED:
+                case SDL_EVENT_WINDOW_RESTORED:
+                    minimised = state.event.type == SDL_EVENT_WINDOW_MINIMIZED;
+                    break;
+                case SDL_EVENT_RENDER_DEVICE_RESET:
+                    // every texture is gone, not only the targets; the cached ones load again when used next
+                    res.textureCache.releaseAll();
+                    [[fallthrough]];
+                case SDL_EVENT_RENDER_TARGETS_RESET:
+                    // the contents of the chunk textures are gone, they get rebuilt when drawn next
+                    gs.tileCache.releaseAll();
+                    gs.parallax.releaseAll();
+                    hud.releaseGlyphs();
+                    break;
+                case SDL_EVENT_KEY_DOWN:
+                    if (state.event.key.scancode == SDL_SCANCODE_P && !state.event.key.repeat)
+                    {
+                        paused = !paused;
+                    }
+#if PROFILER_ENABLED
+                    if (state.event.key.scancode == SDL_SCANCODE_F3)
+                    {
+                        showProfiler = !showProfiler;
+                    }
+                    else if (state.event.key.scancode == SDL_SCANCODE_F4)
+                    {
+                        Profiler::get().writeCsv("profile.csv");
+                        Profiler::get().writeChromeTrace("profile.json");
+                        std::cout << "Wrote profile.csv and profile.json" << std::endl;
+                    }
+#endif
+                    mailbox.post(state.event.key.scancode, true);
+                    break;
+                case SDL_EVENT_KEY_UP:
+                    mailbox.post(state.event.key.scancode, false);
+                    break;
                 }
             }
+            // the simulation reads this copy, never SDL's own keyboard state
+            mailbox.postKeyboard(SDL_GetKeyboardState(nullptr));
+            stage.paused = paused || !focused || minimised;
         }
 
-        // --- RENDERING LOGIC ---
-        // Set the draw color and clear the screen.
-        SDL_SetRenderDrawColor(state.renderer, 20, 10, 30, 255);
-        SDL_RenderClear(state.renderer);
-
-        // Calculating map view point
-        gs.mapViewPort.x = (gs.player().position.x + TILE_SIZE / 2) - gs.mapViewPort.w / 2;
+        audio.update();
 
-        // Draw Background Images
-        SDL_RenderTexture(state.renderer, res.background1, nullptr, nullptr);
-        drawParralaxBackground(state.renderer, res.background4, gs.player().velocity.x, gs.bg4scroll, 0.1f, deltaTime);
-        drawParralaxBackground(state.renderer, res.background3, gs.player().velocity.x, gs.bg3scroll, 0.2f, deltaTime);
-        drawParralaxBackground(state.renderer, res.background2, gs.player().velocity.x, gs.bg2scroll, 0.3f, deltaTime);
-
-        // draw background tiles
-        for (GameObject &obj : gs.backgroundTiles)
+        // --- SIMULATION ---
+        // pipelined, the simulation thread is already working on the next frames
+        if (serial)
         {
-            SDL_FRect dst{
-                .x = obj.position.x - gs.mapViewPort.x,
-                .y = obj.position.y,
-                .w = static_cast<float>(obj.texture->w),
-                .h = static_cast<float>(obj.texture->h)};
-            SDL_RenderTexture(state.renderer, obj.texture, nullptr, &dst);
+            simulateFrame(state, gs, res, audio, input, mailbox, stage, *pipeline.beginProduce());
+            pipeline.endProduce();
         }
-
-        // draw all objects
-        for (auto &layer : gs.layers)
+        FrameRecord *frame = pipeline.beginConsume();
+        if (!frame)
         {
-            for (GameObject &obj : layer)
-            {
-                drawObject(state, gs, obj, deltaTime);
-            }
+            break;
         }
 
-        // draw foreground tiles
-        for (GameObject &obj : gs.foregroundTiles)
+        // --- RENDERING LOGIC ---
+        drawFrame(state, gs, res, frame->commands);
+
+        // --- HUD, on top of the world ---
+        const BroadphaseStats &bpStats = frame->broadphase;
+        const SpriteBatchStats &batchStats = gs.spriteBatch.getStats();
+        const AudioStats audioStats = audio.getStats();
+        hud.set(stateLabel, "state: {}", frame->playerState);
+        hud.set(fpsLabel, "FPS: {}", last_fps);
+        hud.set(pairsLabel, "Pairs: {}/{}", bpStats.candidatePairs, bpStats.bruteForcePairs);
+        hud.set(batchesLabel, "Batches: {}/{}", batchStats.batches, batchStats.sprites);
+        hud.set(audioLabel, "Audio: {:.1f}ms {}xrun", audioStats.latencyMs, audioStats.underruns);
+        hud.set(frameLabel, "Frame: {:.2f}+-{:.2f}ms", pacer.getFrameMs(), pacer.getJitterMs());
+        const TextureCacheStats &textureStats = res.textureCache.getStats();
+        hud.set(texturesLabel, "Tex: {:.1f}MB {}miss {}ev", textureStats.residentBytes / 1048576.0, textureStats.misses, textureStats.evictions);
+        const RollbackStats &netStats = frame->netplay;
+        hud.set(netplayLabel, "Net: rb {} {:.2f}ms wait {} desync {}", netStats.lastRollbackTicks, netStats.lastRollbackMs, netStats.stalls, netStats.desyncs);
+        hud.setVisible(pausedLabel, stage.paused);
+        hud.draw(state.renderer);
+
+#if PROFILER_ENABLED
+        if (showProfiler)
         {
-            SDL_FRect dst{
-                .x = obj.position.x - gs.mapViewPort.x,
-                .y = obj.position.y,
-                .w = static_cast<float>(obj.texture->w),
-                .h = static_cast<float>(obj.texture->h)};
-            SDL_RenderTexture(state.renderer, obj.texture, nullptr, &dst);
+            Profiler::get().drawOverlay(state.renderer, SDL_FRect{5, state.logical_height - 125.0f, 240, 60});
         }
-
-        SDL_SetRenderDrawColor(state.renderer, 255, 255, 255, 255);
-        SDL_RenderDebugText(state.renderer, 5, 5,
-                            std::format("state: {}", static_cast<int>(gs.player().data.player.state)).c_str());
-
-        SDL_SetRenderDrawColor(state.renderer, 0, 255, 0, 255);
-        SDL_RenderDebugText(state.renderer, state.logical_width - 70, 0,
-                            std::format("FPS: {}", last_fps).c_str());
+#endif
 
         // Swap the buffers to display the new frame.
-        SDL_RenderPresent(state.renderer);
+        {
+            PROFILE_SCOPE(ProfilePhase::present);
+            SDL_RenderPresent(state.renderer);
+        }
+        res.textureCache.endFrame();
+        if (frame->finished)
+        {
+            running = false;
+        }
+        pipeline.endConsume();
 
         // --- END OF FRAME ---
-        // Set the previous time to the current time for the next frame's calculation.
-        prevTime = nowTime;
+        // Wait out the rest of the frame when capped; idle frames already waited for events
+        if (!stage.paused)
+        {
+            pacer.endFrame();
+        }
+        PROFILE_END_FRAME();
+    }
+    pipeline.stop();
+    if (simulation.joinable())
+    {
+        simulation.join();
     }
 
     // --- CLEANUP AFTER LOOP ---
+    if (input.isRecording())
+    {
+        std::cout << "Recorded " << input.getTick() << " ticks to " << recordPath << std::endl;
+    }
+    input.close(simulationChecksum(gs));
+    audio.close();
+    hud.releaseGlyphs();
+    gs.tileCache.releaseAll();
+    gs.parallax.releaseAll();
     res.unload();
     cleanup(state);
     return 0;
@@ -296,6 +901,12 @@ bool initialise(SDLState &state)
         return false;
     }
 
+    // Audio is optional, without a device the game runs silently
+    if (!SDL_InitSubSystem(SDL_INIT_AUDIO))
+    {
+        SDL_Log("Error initializing audio: %s", SDL_GetError());
+    }
+
     // Create the main application window.
     state.window = SDL_CreateWindow("Tutorial Game", state.width, state.height, SDL_WINDOW_RESIZABLE);
     if (!state.window)
@@ -320,345 +931,1465 @@ bool initialise(SDLState &state)
     return true;
 }
 
-void drawObject(const SDLState &state, GameState &gs, GameObject &obj, float deltaTime)
-{
-    // Define the source and destination rectangles for rendering.
-    const float spriteSize = 32;
-    float srcX = obj.currentAnimation != -1 ? obj.animations[obj.currentAnimation].currentFrame() * spriteSize : 0.0f;
-
-    SDL_FRect src{
-        .x = srcX,
-        .y = 0,
-        .w = spriteSize,
-        .h = spriteSize};
-
-    SDL_FRect dst{
-        .x = obj.position.x - gs.mapViewPort.x,
-        .y = obj.position.y,
-        .w = spriteSize,
-        .h = spriteSize};
-
-    SDL_FlipMode flipMode = obj.direction == -1 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
-
-    // Render the texture to the screen.
-    SDL_RenderTextureRotated(state.renderer, obj.texture, &src, &dst, 0, nullptr, flipMode);
-}
-
-void update(const SDLState &state, GameState &gs, GameObject &obj, const Resources &res, float deltaTime)
+/**
+ * @brief Shows a progress bar until the loader has decoded and uploaded everything.
+ * @param state The current SDL application state.
+ * @param loader The loader with the queued assets.
+ * @return False if the window was closed while loading.
+ */
+bool runLoadingScreen(SDLState &state, AsyncLoader &loader)
 {
-    if (obj.dynamic)
-    {
-        // Apply Some Gravity
-        obj.velocity += glm::vec2(0, 500) * deltaTime;
-    }
-
-    if (obj.type == ObjectType::player)
+    while (!loader.isDone())
     {
-        float currentDirection = 0;
-        float moveAmount = 0;
-
-        // We will do +1 and -1 to make sure that if user has pressed both keys then it will negate each other
-        if (state.keys[SDL_SCANCODE_A] || state.keys[SDL_SCANCODE_LEFT]) // Left Key
-            currentDirection -= 1;
-        if (state.keys[SDL_SCANCODE_D] || state.keys[SDL_SCANCODE_RIGHT]) // Right Direction
-            currentDirection += 1;
-
-        // If the user has pressed a key then assign the direction to the player
-        if (currentDirection)
-            obj.direction = currentDirection;
-
-        switch (obj.data.player.state)
+        while (SDL_PollEvent(&state.event))
         {
-        case PlayerState::idle:
-            if (currentDirection)
-            {
-                obj.data.player.state = PlayerState::running;
-            }
-            else
-            {
-                // decelarate
-                if (obj.velocity.x)
-                {
-                    // if the velocity is positive i.e. in the right direction we use a negative factor and vice-versa
-                    const float factor = obj.velocity.x > 0 ? -1.5f : 1.5f;
-                    float amount = factor * obj.acceleration.x * deltaTime;
-
-                    // if velocity is already less than amount than further decelaration is not possible so we set it to 0
-                    if (std::abs(obj.velocity.x) < std::abs(amount))
-                        obj.velocity.x = 0;
-                    else
-                        obj.velocity.x += amount; // amount will be always inverse to velocity because of factor so we add it
-                }
-            }
-            obj.texture = res.idle_texture;
-            obj.currentAnimation = res.ANIM_PLAYER_IDLE;
-            break;
-        case PlayerState::running:
-            if (!currentDirection)
-            {
-                obj.data.player.state = PlayerState::idle;
-            }
-
-            // moving in opposite direction will make a sliding
-            if (obj.velocity.x * obj.direction < 0 && obj.grounded)
-            {
-                obj.texture = res.sliding_texture;
-                obj.currentAnimation = res.ANIM_PLAYER_SLIDE;
-            }
-            else
+            if (state.event.type == SDL_EVENT_QUIT)
             {
-                obj.texture = res.run_texture;
-                obj.currentAnimation = res.ANIM_PLAYER_RUN;
+                return false;
             }
-            break;
-        case PlayerState::jumping:
-            obj.texture = res.run_texture;
-            obj.currentAnimation = res.ANIM_PLAYER_RUN;
-            break;
         }
 
-        // This is to calculate velocity of the object
-        obj.velocity += currentDirection * obj.acceleration * deltaTime;
+        loader.pump(state.renderer, LOAD_UPLOAD_BUDGET_NS);
+
+        SDL_SetRenderDrawColor(state.renderer, 20, 10, 30, 255);
+        SDL_RenderClear(state.renderer);
+
+        const float progress = loader.getProgress();
+        SDL_FRect outline{
+            .x = state.logical_width * 0.25f,
+            .y = state.logical_height * 0.5f,
+            .w = state.logical_width * 0.5f,
+            .h = 8};
+        SDL_FRect bar = outline;
+        bar.w *= progress;
+
+        SDL_SetRenderDrawColor(state.renderer, 255, 255, 255, 255);
+        SDL_RenderRect(state.renderer, &outline);
+        SDL_RenderFillRect(state.renderer, &bar);
+        SDL_RenderDebugText(state.renderer, outline.x, outline.y - 12,
+                            std::format("Loading {}%", static_cast<int>(progress * 100)).c_str());
 
-        // If the velocity is greater than max speed than reduce it to max speed
-        // we use absolute value because velocity can be negative for currentDirection = -1
-        if (std::abs(obj.velocity.x) > obj.maxSpeedX)
-            obj.velocity.x = obj.maxSpeedX * currentDirection;
+        SDL_RenderPresent(state.renderer);
     }
-    obj.position += obj.velocity * deltaTime;
+    return true;
+}
 
-    // Handle Collision
-    bool foundGround = false;
-    for (auto &layers : gs.layers)
+/**
+ * @brief Simulation stage of one frame: takes the input posted since the last frame, runs as many ticks
+ * as the time since then allows and records the frame. Nothing here needs the renderer, so it can run on
+ * another thread than drawFrame().
+ * @param state The current SDL application state.
+ * @param gs The game state to advance.
+ * @param res The loaded resources.
+ * @param audio The mixer, for the sounds of each tick.
+ * @param input The journal, live or replaying; its source should be stage.keys.
+ * @param mailbox Input posted by the event loop.
+ * @param stage Timing and keyboard kept between frames.
+ * @param frame Where the frame is recorded.
+ * @return False once a replay has run out of ticks; frame.finished is set then.
+ */
+bool simulateFrame(const SDLState &state, GameState &gs, const Resources &res, AudioMixer &audio, InputJournal &input, InputMailbox &mailbox, SimulationStage &stage, FrameRecord &frame)
+{
+    const Uint64 now = SDL_GetTicksNS();
+    const float deltaTime = (now - stage.prevTime) / 1e9f;
+    stage.prevTime = now;
+
+    mailbox.collect(input, stage.keys);
+
+    // Run as many fixed simulation ticks as the elapsed time allows; none while paused, and the time
+    // paused is not caught up on afterwards
+    frame.finished = false;
+    const int steps = stage.paused ? 0 : stage.timestep.advance(deltaTime * stage.frameScale);
+    for (int step = 0; step < steps; step++)
     {
-        for (GameObject &objB : layers)
+        const bool wasGrounded = gs.entities.bodies[gs.player(gs.localPlayer)].grounded;
+        if (stage.netplay)
         {
-            if (&obj != &objB)
+            // a tick spent waiting for the other player has nothing to sound
+            if (!advanceNetplay(state, gs, res, input, *stage.netplay, stage.timestep.getTickLength()))
             {
-                checkCollision(state, gs, res, obj, objB, deltaTime);
-
-                // grounded sensor
-                SDL_FRect sensor{
-                    .x = obj.position.x + obj.collider.x,
-                    .y = obj.position.y + obj.collider.y + obj.collider.h,
-                    .w = obj.collider.w,
-                    .h = 1};
-
-                SDL_FRect rectB{
-                    .x = objB.position.x + objB.collider.x,
-                    .y = objB.position.y + objB.collider.y,
-                    .w = objB.collider.w,
-                    .h = objB.collider.h};
-
-                if (SDL_HasRectIntersectionFloat(&sensor, &rectB))
-                {
-                    foundGround = true;
-                }
+                continue;
             }
         }
-    }
-    if (obj.grounded != foundGround)
-    {
-        // We are changing the state
-        obj.grounded = foundGround;
-        if (foundGround && obj.type == ObjectType::player)
+        else if (!simulateTick(state, gs, res, input, stage.timestep.getTickLength()))
         {
-            obj.data.player.state = PlayerState::running;
+            const bool matches = simulationChecksum(gs) == input.getHeader().checksum;
+            std::cout << "Replay finished after " << input.getTick() << " ticks, "
+                      << (matches ? "matching the recording" : "NOT matching the recording") << std::endl;
+            frame.finished = true;
+            break;
         }
+        playTickSounds(gs, audio, wasGrounded);
     }
 
-    SDL_SetRenderDrawColor(state.renderer, 255, 255, 255, 255);
-    SDL_RenderDebugText(state.renderer, 5, 20,
-                        std::format("OBJ Grounded: {}", static_cast<int>(gs.player().grounded)).c_str());
-
-    SDL_SetRenderDrawColor(state.renderer, 255, 255, 255, 255);
-    SDL_RenderDebugText(state.renderer, 5, 35,
-                        std::format("Found Ground: {}", static_cast<int>(foundGround)).c_str());
+    // where rendering sits between the last two ticks
+    recordFrame(gs, res, stage.timestep.getAlpha(), frame.commands);
+    frame.playerState = static_cast<int>(gs.entities.data[gs.player(gs.localPlayer)].player.state);
+    frame.broadphase = gs.broadphase.getStats();
+    frame.netplay = stage.netplay ? stage.netplay->session.getStats() : RollbackStats();
+    return !frame.finished;
 }
 
-void collisionResponse(const SDLState &state, GameState &gs, const Resources &res, const SDL_FRect &rectA, const SDL_FRect &rectB, const SDL_FRect &rectC, GameObject &a, GameObject &b, float deltaTime)
+/**
+ * @brief Records the world into a command buffer: background, tile layers and objects, but no debug text.
+ * Nothing is drawn yet, see drawFrame().
+ * @param gs The game state to draw.
+ * @param res The loaded resources.
+ * @param alpha Where between the last two ticks to draw moving objects.
+ * @param commands The buffer to record into, cleared first.
+ */
+void recordFrame(GameState &gs, const Resources &res, float alpha, RenderCommandBuffer &commands)
 {
-    if (a.type == ObjectType::player)
-    {
-        switch (b.type)
+    // Calculating map view point from the interpolated player position
+    const size_t player = gs.player(gs.localPlayer);
+    const Transform &playerTransform = gs.entities.transforms[player];
+    const glm::vec2 playerPos = glm::mix(playerTransform.prevPosition, playerTransform.position, alpha);
+    gs.mapViewPort.x = (playerPos.x + TILE_SIZE / 2) - gs.mapViewPort.w / 2;
+
+    commands.clear();
+
+    // Background Images, scrolled by how far the camera is into the level
+    commands.background(gs.mapViewPort);
+
+    // background and level tiles
+    drawTileLayer(gs, commands, TileLayer::background, BATCH_LAYER_BACKGROUND);
+    drawTileLayer(gs, commands, TileLayer::level, BATCH_LAYER_LEVEL);
+
+    // all objects
+    {
+        PROFILE_SCOPE(ProfilePhase::drawObjects);
+        drawEnemies(gs, res, commands, alpha);
+        for (size_t i = 0; i < gs.entities.size(); i++)
+        {
+            drawObject(gs, res, commands, i, alpha);
+        }
+        drawProjectiles(gs, res, commands, alpha);
+    }
+
+    // foreground tiles
+    drawTileLayer(gs, commands, TileLayer::foreground, BATCH_LAYER_FOREGROUND);
+}
+
+/**
+ * @brief Render stage: plays a recorded frame back on the renderer, but no debug text and no present.
+ * Everything that needs the renderer (the background compositor, the tile chunk cache, the sprite batch,
+ * the texture cache) is only used from here.
+ * @param state The current SDL application state.
+ * @param gs The game state owning the render caches.
+ * @param res The loaded resources; texture handles are resolved through their cache, which loads evicted ones again.
+ * @param commands The recorded frame.
+ */
+void drawFrame(const SDLState &state, GameState &gs, Resources &res, const RenderCommandBuffer &commands)
+{
+    // Set the draw color and clear the screen.
+    SDL_SetRenderDrawColor(state.renderer, 20, 10, 30, 255);
+    SDL_RenderClear(state.renderer);
+
+    gs.tileCache.resetStats();
+    for (const RenderCommand &command : commands)
+    {
+        switch (command.type)
+        {
+        case RenderCommandType::background:
+        {
+            PROFILE_SCOPE(ProfilePhase::drawBackground);
+            gs.parallax.draw(state.renderer, res.textureCache, command.dst);
+            break;
+        }
+        case RenderCommandType::tiles:
         {
-        case ObjectType::level:
+            PROFILE_SCOPE(ProfilePhase::drawTiles);
+            // missing chunks are built from the tile map, which the simulation may be streaming right now
+            std::lock_guard lock(gs.tilesMutex);
+            gs.tileCache.draw(state.renderer, res.textureCache, gs.spriteBatch, command.batchLayer, gs.tiles, command.tileLayer, command.dst);
+            break;
+        }
+        case RenderCommandType::sprite:
         {
-            if (rectC.w < rectC.h)
+            gs.spriteBatch.draw(res.textureCache.get(state.renderer, command.texture), &command.src, command.dst, command.flip, command.batchLayer);
+            break;
+        }
+        }
+    }
+
+    // draw everything queued, one geometry call per texture run
+    {
+        PROFILE_SCOPE(ProfilePhase::flush);
+        gs.spriteBatch.flush(state.renderer, &gs.frameArena);
+    }
+}
+
+/**
+ * @brief Runs the game for a fixed number of frames on scripted input and writes the frame timings.
+ * @param state The SDL application state, usually on the offscreen video driver.
+ * @param gs The game state with the level already created.
+ * @param res The loaded resources.
+ * @param audio The mixer; a sound is played on every landing so the audio path is measured too.
+ * @param input The input journal. When it replays (--replay) the run plays the recorded session, up to
+ * config.frames ticks, instead of the input script.
+ * @param config What to run and where to report it. With config.rollback every frame also rolls back that many
+ * ticks and simulates them again, the way netplay does when a late input turns out different from the prediction.
+ * @return The process exit code: non-zero if the run could not be measured, regressed against the baseline or
+ * a rollback did not end in the same state.
+ */
+int runBenchmark(SDLState &state, GameState &gs, Resources &res, AudioMixer &audio, InputJournal &input, const BenchConfig &config)
+{
+#if !PROFILER_ENABLED
+    std::cout << "The benchmark needs the profiler, build it with 'make bench'" << std::endl;
+    return 1;
+#else
+    // the script stands in for the keyboard, so its key presses go through the journal like real ones
+    BenchInput script;
+    if (!config.script.empty() && !script.load(config.script))
+    {
+        std::cout << "Could not read input script " << config.script << std::endl;
+        return 1;
+    }
+    input.setSource(script.getKeys());
+
+    // Extra bodies spread over the level, they fall onto it and wander left and right
+    EntityStore &es = gs.entities;
+    SDL_srand(1);
+    for (int i = 0; i < config.entities; i++)
+    {
+        const size_t index = es.indexOf(es.create(ObjectType::enemy));
+        Transform &transform = es.transforms[index];
+        transform.position = glm::vec2(SDL_randf() * (gs.tiles.getColumns() - 1) * TILE_SIZE, 0);
+        transform.prevPosition = transform.position;
+
+        es.sprites[index].play(res.clipPlayerIdle);
+
+        PhysicsBody &body = es.bodies[index];
+        body.velocity = glm::vec2(SDL_randf() * 100 - 50, 0);
+        body.dynamic = true;
+
+        es.colliders[index] = {.x = 11, .y = 6, .w = 10, .h = 26};
+    }
+
+    // and extra enemies, dropped onto the level anywhere along it
+    const int rows = gs.tiles.getRows(), columns = gs.tiles.getColumns();
+    for (int i = 0; i < config.enemies; i++)
+    {
+        const int column = static_cast<int>(SDL_randf() * (columns - 1));
+        gs.enemies.spawn(0, column, rows, columns, gs.tiles.getOrigin(), TILE_SIZE, [&gs](int r, int c)
+                         { return isLevelSolid(gs, r, c); });
+    }
+    gs.enemies.finishSpawning();
+
+    // One tick per frame so every run simulates exactly the same thing
+    FixedTimestep timestep(DEFAULT_TICK_RATE, MAX_STEPS_PER_FRAME);
+    const float deltaTime = timestep.getTickLength();
+
+    RenderCommandBuffer commands;
+    BenchReport report;
+    report.reserve(config.frames);
+    // heap allocations of every frame, on all threads; after the warm up a frame must not make any
+    AllocCounts allocated, steadyAllocated;
+    int allocatingFrames = 0;
+
+    // the state at the start of the last ticks and what they were simulated with, to go back to
+    struct TickInput
+    {
+        std::array<PlayerInput, MAX_PLAYERS> inputs{};
+        float length = 0;
+    };
+    const uint32_t rollbackTicks = static_cast<uint32_t>(config.rollback);
+    SnapshotRing snapshots(rollbackTicks + 1);
+    std::vector<TickInput> tickInputs(rollbackTicks + 1);
+    Snapshot beforeRollback, afterRollback; // the state as simulated and as simulated again
+    uint32_t ticks = 0;
+    int rollbackMismatches = 0;
+    double rollbackMaxMs = 0;
+
+    int frames = 0;
+    for (bool running = true; running && frames < config.frames; frames++)
+    {
+        const AllocCounts frameStart = ALLOC_COUNTS_TOTAL();
+        gs.frameArena.reset();
+        {
+            PROFILE_SCOPE(ProfilePhase::events);
+            SDL_PumpEvents();
+            script.play(frames, [&input](SDL_Scancode key, bool down)
+                        { input.queueKey(key, down); });
+        }
+
+        audio.update();
+
+        const int steps = timestep.advance(deltaTime);
+        for (int step = 0; step < steps; step++)
+        {
+            const bool wasGrounded = gs.entities.bodies[gs.player(gs.localPlayer)].grounded;
+            TickInput &tick = tickInputs[ticks % tickInputs.size()];
+            tick.length = timestep.getTickLength();
+            if (!input.beginTick(tick.length))
             {
-                // Horizontal Collision
-                if (a.velocity.x > 0)
-                {
-                    // We have a positive velocity, i.e. we are going in the right direction
-                    a.position.x -= rectC.w;
-                }
-                else if (a.velocity.x < 0)
-                {
-                    // We have a negative velocity, i.e. we are going in the left direction
-                    a.position.x += rectC.w;
-                }
-                a.velocity.x = 0;
+                running = false; // the replay ended, this frame is still drawn and counted
+                break;
             }
-            else
+            tick.inputs = {};
+            tick.inputs[gs.localPlayer] = readPlayerInput(input);
+            if (rollbackTicks > 0)
             {
-                // Vertical Collision
-                if (a.velocity.y > 0)
-                {
-                    // We have a positive velocity, i.e. we are going in the downward direction
-                    a.position.y -= rectC.h;
-                }
-                else if (a.velocity.y < 0)
+                Snapshot &snapshot = snapshots.at(ticks);
+                snapshot.begin(ticks);
+                saveSimulation(gs, snapshot);
+            }
+            simulateInputs(state, gs, res, tick.inputs.data(), tick.length);
+            ticks++;
+            playTickSounds(gs, audio, wasGrounded);
+        }
+
+        // Go back and simulate the same ticks again, which has to arrive at the very same state
+        if (rollbackTicks > 0 && ticks >= rollbackTicks)
+        {
+            PROFILE_SCOPE(ProfilePhase::rollback);
+            beforeRollback.begin(ticks);
+            saveSimulation(gs, beforeRollback);
+
+            const Uint64 start = SDL_GetPerformanceCounter();
+            loadSimulation(gs, *snapshots.find(ticks - rollbackTicks));
+            for (uint32_t t = ticks - rollbackTicks; t < ticks; t++)
+            {
+                const TickInput &tick = tickInputs[t % tickInputs.size()];
+                simulateInputs(state, gs, res, tick.inputs.data(), tick.length);
+            }
+            rollbackMaxMs = std::max(rollbackMaxMs, (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+
+            // byte for byte, so it covers everything a snapshot holds and not just what the replay checksum hashes
+            afterRollback.begin(ticks);
+            saveSimulation(gs, afterRollback);
+            if (!afterRollback.sameState(beforeRollback))
+            {
+                rollbackMismatches++;
+            }
+        }
+        recordFrame(gs, res, timestep.getAlpha(), commands);
+        drawFrame(state, gs, res, commands);
+
+        {
+            PROFILE_SCOPE(ProfilePhase::present);
+            SDL_RenderPresent(state.renderer);
+        }
+        res.textureCache.endFrame();
+        PROFILE_END_FRAME();
+
+        std::array<double, PROFILE_PHASE_COUNT> phases;
+        for (size_t p = 0; p < PROFILE_PHASE_COUNT; p++)
+        {
+            phases[p] = Profiler::get().getLastPhaseMs(static_cast<ProfilePhase>(p));
+        }
+        report.addFrame(Profiler::get().getLastFrameMs(), phases);
+
+        const AllocCounts frameAllocs = ALLOC_COUNTS_TOTAL() - frameStart;
+        allocated += frameAllocs;
+        if (frames >= config.allocWarmup && frameAllocs.allocations > 0)
+        {
+            steadyAllocated += frameAllocs;
+            // the first few are enough to find the culprit; printing them allocates too, but before the next frame starts
+            if (allocatingFrames++ < 5)
+            {
+                std::cout << "Frame " << frames << " allocated " << frameAllocs.allocations << " times ("
+                          << frameAllocs.bytes << " bytes):";
+                for (size_t p = 0; p < PROFILE_PHASE_COUNT; p++)
                 {
-                    // We have a negative velocity, i.e. we are going in the upward direction
-                    a.position.y += rectC.h;
+                    if (const uint32_t count = Profiler::get().getLastPhaseAllocs(static_cast<ProfilePhase>(p)))
+                    {
+                        std::cout << ' ' << PROFILE_PHASE_NAMES[p] << ' ' << count;
+                    }
                 }
-                a.velocity.y = 0;
+                std::cout << std::endl;
             }
-            break;
         }
+    }
+
+    report.set("frames", frames);
+    report.set("entities", static_cast<double>(es.size()));
+    report.set("enemies", static_cast<double>(gs.enemies.size()));
+    report.set("enemies_updated", static_cast<double>(gs.enemies.getUpdated()));
+    report.set("columns", gs.tiles.getColumns());
+    const AudioStats audioStats = audio.getStats();
+    report.set("audio_latency_max_ms", audioStats.maxLatencyMs);
+    report.set("audio_underruns", audioStats.underruns);
+    const TextureCacheStats &textureStats = res.textureCache.getStats();
+    report.set("texture_peak_mb", textureStats.peakBytes / 1048576.0);
+    report.set("texture_misses", static_cast<double>(textureStats.misses));
+    report.set("texture_evictions", static_cast<double>(textureStats.evictions));
+    report.set("frame_arena_peak_kb", gs.frameArena.getPeak() / 1024.0);
+    report.set("rollback_ticks", config.rollback);
+    report.set("rollback_mismatches", rollbackMismatches);
+    report.set("rollback_max_ms", rollbackMaxMs);
+#if ALLOC_TRACKING
+    report.set("allocs_per_frame", frames ? static_cast<double>(allocated.allocations) / frames : 0);
+    report.set("alloc_bytes_per_frame", frames ? static_cast<double>(allocated.bytes) / frames : 0);
+    report.set("steady_allocating_frames", allocatingFrames);
+    report.set("steady_allocs", static_cast<double>(steadyAllocated.allocations));
+#endif
+    if (!report.write(config.output))
+    {
+        std::cout << "Could not write " << config.output << std::endl;
+        return 1;
+    }
+    if (allocatingFrames > 0)
+    {
+        std::cout << allocatingFrames << " frames after the first " << config.allocWarmup
+                  << " allocated from the heap, the steady state must not allocate" << std::endl;
+        return 1;
+    }
+    if (rollbackMismatches > 0)
+    {
+        std::cout << rollbackMismatches << " rollbacks of " << config.rollback
+                  << " ticks ended in a different state, the simulation is not deterministic" << std::endl;
+        return 1;
+    }
+    if (rollbackMaxMs > ROLLBACK_BUDGET_MS)
+    {
+        std::cout << "A rollback of " << config.rollback << " ticks took " << rollbackMaxMs << " ms, over the "
+                  << ROLLBACK_BUDGET_MS << " ms budget" << std::endl;
+        return 1;
+    }
+    if (!config.baseline.empty() && !report.checkBaseline(config.baseline, config.tolerance))
+    {
+        return 1;
+    }
+    return 0;
+#endif
+}
+
+void drawObject(const GameState &gs, const Resources &res, RenderCommandBuffer &commands, size_t index, float alpha)
+{
+    const Transform &transform = gs.entities.transforms[index];
+    const Sprite &sprite = gs.entities.sprites[index];
+
+    // Draw between the previous and current tick so motion stays smooth when frame rate and tick rate differ
+    const glm::vec2 position = glm::mix(transform.prevPosition, transform.position, alpha);
+
+    // The frame knows where it is in the atlas and how big it is
+    const AnimationFrame *frame = res.animations.getFrame(sprite);
+    if (!frame)
+    {
+        return;
+    }
+
+    SDL_FRect dst{
+        .x = position.x - gs.mapViewPort.x,
+        .y = position.y,
+        .w = frame->rect.w,
+        .h = frame->rect.h};
+
+    SDL_FlipMode flipMode = transform.direction == -1 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+
+    // Record the sprite, it is batched and drawn when the frame is played back
+    commands.sprite(res.animations.getTexture(sprite), frame->rect, dst, flipMode, BATCH_LAYER_OBJECTS);
+}
+
+/**
+ * @brief Records every live bullet and hit effect, straight from the dense pool arrays.
+ * @param gs The game state holding the pools.
+ * @param res The loaded resources.
+ * @param commands The frame being recorded.
+ * @param alpha Where between the last two ticks to draw the bullets.
+ */
+void drawProjectiles(const GameState &gs, const Resources &res, RenderCommandBuffer &commands, float alpha)
+{
+    // centred on their position
+    const auto queue = [&gs, &res, &commands](const AnimationPlayhead &animation, glm::vec2 position, bool flipped)
+    {
+        const AnimationFrame *frame = res.animations.getFrame(animation);
+        if (!frame)
+        {
+            return;
         }
+        SDL_FRect dst{
+            .x = position.x - frame->rect.w / 2 - gs.mapViewPort.x,
+            .y = position.y - frame->rect.h / 2,
+            .w = frame->rect.w,
+            .h = frame->rect.h};
+        commands.sprite(res.animations.getTexture(animation), frame->rect, dst,
+                        flipped ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE, BATCH_LAYER_OBJECTS);
+    };
+
+    for (const Bullet &bullet : gs.bullets)
+    {
+        queue(bullet.animation, glm::mix(bullet.prevPosition, bullet.position, alpha), bullet.velocity.x < 0);
+    }
+    for (const Effect &effect : gs.effects)
+    {
+        queue(effect.animation, effect.position, effect.flipped);
     }
 }
 
-void checkCollision(const SDLState &state, GameState &gs, const Resources &res, GameObject &a, GameObject &b, float deltaTime)
+/**
+ * @brief Records the enemies in view; the enemy system only hands out the ones its sort order puts near the view port.
+ * @param gs The game state holding the enemies.
+ * @param res The loaded resources.
+ * @param commands The frame being recorded.
+ * @param alpha Where between the last two ticks to draw them.
+ */
+void drawEnemies(const GameState &gs, const Resources &res, RenderCommandBuffer &commands, float alpha)
 {
-    SDL_FRect rectA{
-        .x = a.position.x + a.collider.x,
-        .y = a.position.y + a.collider.y,
-        .w = a.collider.w,
-        .h = a.collider.h};
+    gs.enemies.forEachVisible(gs.mapViewPort, alpha, [&gs, &res, &commands](const AnimationPlayhead &animation, glm::vec2 position, bool flipped)
+                              {
+        const AnimationFrame *frame = res.animations.getFrame(animation);
+        if (!frame)
+        {
+            return;
+        }
+        SDL_FRect dst{
+            .x = position.x - gs.mapViewPort.x,
+            .y = position.y,
+            .w = frame->rect.w,
+            .h = frame->rect.h};
+        commands.sprite(res.animations.getTexture(animation), frame->rect, dst,
+                        flipped ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE, BATCH_LAYER_OBJECTS); });
+}
+
+/**
+ * @brief Records one tile layer for the map view port; its visible chunks are queued when the frame is drawn.
+ * @param gs The game state holding the view port.
+ * @param commands The frame being recorded.
+ * @param layer The tile layer to draw.
+ * @param batchLayer The sprite batch layer the chunks are queued on.
+ */
+void drawTileLayer(const GameState &gs, RenderCommandBuffer &commands, TileLayer layer, int batchLayer)
+{
+    commands.tiles(layer, batchLayer, gs.mapViewPort);
+}
+
+/**
+ * @brief Advances the whole simulation by one tick.
+ * The work is split into phases that each only write to the entity they are looking at, so every phase
+ * runs over disjoint entity ranges on the job system and the result is the same for any number of threads.
+ * @param state The current SDL application state.
+ * @param gs The game state to advance.
+ * @param res The loaded resources.
+ * @param deltaTime Length of the tick in seconds.
+ */
+void simulate(const SDLState &state, GameState &gs, const Resources &res, const PlayerInput *inputs, float deltaTime)
+{
+    EntityStore &es = gs.entities;
+
+    // Remember where everything was so rendering can interpolate towards the new positions
+    gs.jobs.parallelFor(es.size(), SIM_GRAIN, [&es](size_t begin, size_t end)
+                        {
+        for (size_t i = begin; i < end; i++)
+        {
+            es.transforms[i].prevPosition = es.transforms[i].position;
+        } });
+
+    // Per type behaviour, only players have any so far; it spawns bullets, so it stays on this thread
+    {
+        PROFILE_SCOPE(ProfilePhase::update);
+        for (size_t i = 0; i < es.size(); i++)
+        {
+            if (es.types[i] == ObjectType::player)
+            {
+                update(gs, i, res, inputs[es.data[i].player.number], deltaTime);
+            }
+        }
+    }
 
-    SDL_FRect rectB{
-        .x = b.position.x + b.collider.x,
-        .y = b.position.y + b.collider.y,
-        .w = b.collider.w,
-        .h = b.collider.h};
+    // Enemies near the first player every tick, further ones less often, far ones not at all
+    {
+        PROFILE_SCOPE(ProfilePhase::enemies);
+        const glm::vec2 playerCentre = es.transforms[gs.player()].position + glm::vec2(TILE_SIZE / 2);
+        gs.enemies.update(simulationView(gs), playerCentre, deltaTime, res.animations);
+    }
 
-    SDL_FRect rectC{0}; // this is the rect that will check for collision
+    {
+        PROFILE_SCOPE(ProfilePhase::integrate);
+        integrate(gs, deltaTime);
+    }
 
-    if (SDL_GetRectIntersectionFloat(&rectA, &rectB, &rectC))
+    // Collisions for everything that moved
+    {
+        PROFILE_SCOPE(ProfilePhase::broadphase);
+        updateBroadphase(gs);
+    }
     {
-        // Found intersection
-        collisionResponse(state, gs, res, rectA, rectB, rectC, a, b, deltaTime);
+        PROFILE_SCOPE(ProfilePhase::narrowphase);
+        findContacts(gs);
     }
+    {
+        PROFILE_SCOPE(ProfilePhase::resolve);
+        gs.jobs.parallelFor(es.size(), SIM_GRAIN, [&](size_t begin, size_t end)
+                            {
+            for (size_t i = begin; i < end; i++)
+            {
+                if (es.bodies[i].dynamic)
+                {
+                    resolveCollisions(state, gs, i, res, deltaTime);
+                }
+            } });
+    }
+
+    {
+        PROFILE_SCOPE(ProfilePhase::animation);
+        // every playhead of a range in one pass over the dense sprite array; frame events are kept
+        // per range so they come out in the same order whatever the thread count
+        gs.jobs.parallelFor(es.size(), SIM_GRAIN, [&gs, &es, &res, deltaTime](size_t begin, size_t end)
+                            {
+            SimChunk &chunk = gs.simChunks[begin / SIM_GRAIN];
+            chunk.events.clear();
+            res.animations.step(&es.sprites[begin], end - begin, deltaTime, [&chunk, begin](size_t i, uint32_t event)
+                                { chunk.events.push_back({begin + i, event}); }); });
+    }
+
+    PROFILE_SCOPE(ProfilePhase::projectiles);
+    updateProjectiles(gs, res, deltaTime);
 }
 
-void createTiles(const SDLState &state, GameState &gs, const Resources &res)
+/**
+ * @brief Runs one simulation tick on the next tick of input, as the local player's.
+ * @param state The current SDL application state.
+ * @param gs The game state to advance.
+ * @param res The loaded resources.
+ * @param input The journal, live or replaying.
+ * @param tickLength Length of the tick in seconds; a replay uses the recorded one.
+ * @return False when a replay has no ticks left, nothing is simulated then.
+ */
+bool simulateTick(const SDLState &state, GameState &gs, const Resources &res, InputJournal &input, float tickLength)
 {
-    /*
-    1 - Ground
-    2 - Panel
-    3 - Enemy
-    4 - Player
-    5 - Grass
-    6 - Brick
-    */
-    short map[MAP_ROWS][MAP_COLUMNS] = {
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 4, 0, 0, 0, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-    };
+    if (!input.beginTick(tickLength))
+    {
+        return false;
+    }
+    std::array<PlayerInput, MAX_PLAYERS> inputs{};
+    inputs[gs.localPlayer] = readPlayerInput(input);
+    simulateInputs(state, gs, res, inputs.data(), tickLength);
+    return true;
+}
 
-    short foreground[MAP_ROWS][MAP_COLUMNS] = {
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {5, 5, 5, 5, 5, 5, 5, 5, 5, 0, 0, 0, 5, 5, 5, 5, 5, 5, 5, 5, 0, 0, 5, 5, 5, 5, 5, 5, 5, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+/**
+ * @brief Runs one simulation tick: presses first, then the tick itself. What it does only depends on the game state
+ * and the inputs, so a tick simulated again from a snapshot on the same inputs ends up in the same state; rollback
+ * and replays rely on that.
+ * @param state The current SDL application state.
+ * @param gs The game state to advance.
+ * @param res The loaded resources.
+ * @param inputs One per player, indexed by player number.
+ * @param tickLength Length of the tick in seconds.
+ */
+void simulateInputs(const SDLState &state, GameState &gs, const Resources &res, const PlayerInput *inputs, float tickLength)
+{
+    for (size_t p = 0; p < gs.playerCount; p++)
+    {
+        if (inputs[p].pressed & INPUT_JUMP)
+        {
+            handleKeyInput(state, gs, gs.player(p), SDL_SCANCODE_SPACE, true);
+        }
+    }
+    streamLevel(gs);
+    simulate(state, gs, res, inputs, tickLength);
+}
+
+/**
+ * @brief The buttons of the journal's current tick: A or Left, D or Right and J held, Space pressed.
+ * @param input The journal, after beginTick().
+ * @return The input of one player.
+ */
+PlayerInput readPlayerInput(const InputJournal &input)
+{
+    const bool *keys = input.getKeys();
+    PlayerInput player;
+    player.held = static_cast<uint8_t>((keys[SDL_SCANCODE_A] || keys[SDL_SCANCODE_LEFT] ? INPUT_LEFT : 0) |
+                                       (keys[SDL_SCANCODE_D] || keys[SDL_SCANCODE_RIGHT] ? INPUT_RIGHT : 0) |
+                                       (keys[SDL_SCANCODE_J] ? INPUT_SHOOT : 0));
+    input.forEachEvent([&player](SDL_Scancode key, bool down)
+                       {
+        if (key == SDL_SCANCODE_SPACE && down)
+        {
+            player.pressed |= INPUT_JUMP;
+        } });
+    return player;
+}
+
+/**
+ * @brief Takes a snapshot of everything a tick changes: the entities, the bullets and effects and the enemies.
+ * The tile map is left out, ticks never change it; a streamed level is not covered, netplay keeps to the built in one.
+ * @param gs The game state.
+ * @param snapshot Where it goes, begun for the tick already.
+ */
+void saveSimulation(const GameState &gs, Snapshot &snapshot)
+{
+    gs.entities.save(snapshot);
+    gs.bullets.save(snapshot);
+    gs.effects.save(snapshot);
+    gs.enemies.save(snapshot);
+}
+
+/**
+ * @brief Puts the game state back to a snapshot from saveSimulation().
+ * @param gs The game state, with the same level loaded as when the snapshot was taken.
+ * @param snapshot The snapshot.
+ */
+void loadSimulation(GameState &gs, Snapshot &snapshot)
+{
+    snapshot.rewind();
+    gs.entities.load(snapshot);
+    gs.bullets.load(snapshot);
+    gs.effects.load(snapshot);
+    gs.enemies.load(snapshot);
+}
+
+/**
+ * @brief Adds the second player next to the first and connects to whoever controls it.
+ * @param state The current SDL application state.
+ * @param gs The game state, with the built in level created.
+ * @param res The loaded resources.
+ * @param peer "loopback", or host:port of the other instance.
+ * @param port UDP port to listen on.
+ * @param player Which player this side controls.
+ * @param latencyMs Delay of the loopback link.
+ * @return The netplay session, null if the link could not be opened.
+ */
+std::unique_ptr<Netplay> startNetplay(const SDLState &state, GameState &gs, const Resources &res, const std::string &peer, uint16_t port, size_t player, int latencyMs)
+{
+    const auto addPlayers = [&res](GameState &game, size_t localPlayer)
+    {
+        const glm::vec2 spawn = game.entities.transforms[game.player(0)].position + glm::vec2(2 * TILE_SIZE, 0);
+        game.playerHandles[1] = createPlayer(game, res, 1, spawn);
+        game.playerCount = 2;
+        game.localPlayer = localPlayer;
     };
 
-    short background[MAP_ROWS][MAP_COLUMNS] = {
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 6, 6, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 6, 6, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    auto netplay = std::make_unique<Netplay>(player);
+    if (peer == "loopback")
+    {
+        // the same level and players as this side, in a state of its own
+        netplay->peerState = std::make_unique<GameState>(state, 1);
+        createTiles(state, *netplay->peerState, res, gs.tiles.getColumns(), "");
+        addPlayers(*netplay->peerState, 1 - player);
+        netplay->peerSession = std::make_unique<RollbackSession>(netplay->peerLink, 1 - player);
+        NetLink::connectLoopback(netplay->link, netplay->peerLink, static_cast<Uint64>(latencyMs) * 1000000);
+        std::cout << "Netplay against a scripted player over loopback, " << latencyMs << " ms each way" << std::endl;
+    }
+    else
+    {
+        const size_t colon = peer.rfind(':');
+        const uint16_t remotePort = colon == std::string::npos ? NETPLAY_PORT : static_cast<uint16_t>(std::atoi(peer.c_str() + colon + 1));
+        if (!netplay->link.openUdp(port, peer.substr(0, colon), remotePort))
+        {
+            std::cout << "Could not open netplay to " << peer << std::endl;
+            return nullptr;
+        }
+        std::cout << "Netplay with --netplay-player " << player << " on port " << port << " with " << peer
+                  << ", the other side has to run with --netplay-player " << 1 - player << std::endl;
+    }
+    addPlayers(gs, player);
+    return netplay;
+}
+
+/**
+ * @brief Runs one netplay tick: the local input of the journal's next tick goes through the rollback session, and
+ * with a loopback peer that one takes its tick as well, on its input script.
+ * @param state The current SDL application state.
+ * @param gs The game state to advance.
+ * @param res The loaded resources.
+ * @param input The journal, live.
+ * @param netplay The session.
+ * @param tickLength Length of the tick in seconds.
+ * @return False if the tick waited for the other player instead of running.
+ */
+bool advanceNetplay(const SDLState &state, GameState &gs, const Resources &res, InputJournal &input, Netplay &netplay, float tickLength)
+{
+    input.beginTick(tickLength);
+    NetplayGame game{state, gs, res, tickLength};
+    const bool ticked = netplay.session.advance(readPlayerInput(input), game);
+
+    if (netplay.peerSession)
+    {
+        // the script is played from the peer's own tick, a tick it waits is played again
+        PlayerInput scripted;
+        netplay.peerScript.play(static_cast<int>(netplay.peerSession->getTick()), [&scripted](SDL_Scancode key, bool down)
+                                {
+            if (key == SDL_SCANCODE_SPACE && down)
+            {
+                scripted.pressed |= INPUT_JUMP;
+            } });
+        const bool *keys = netplay.peerScript.getKeys();
+        scripted.held = static_cast<uint8_t>((keys[SDL_SCANCODE_A] ? INPUT_LEFT : 0) | (keys[SDL_SCANCODE_D] ? INPUT_RIGHT : 0) |
+                                             (keys[SDL_SCANCODE_J] ? INPUT_SHOOT : 0));
+        NetplayGame peerGame{state, *netplay.peerState, res, tickLength};
+        netplay.peerSession->advance(scripted, peerGame);
+    }
+    return ticked;
+}
+
+/**
+ * @brief Streams the level around the player. Follows the simulated position instead of the camera, so
+ * which chunks are resident does not depend on whether or how often frames are drawn.
+ * @param gs The game state holding the level.
+ */
+void streamLevel(GameState &gs)
+{
+    const SDL_FRect view = simulationView(gs);
+    std::lock_guard lock(gs.tilesMutex);
+    // chunk textures drawn before a level chunk arrived would keep its cells empty
+    gs.level.stream(gs.tiles, view, [&gs](int firstColumn, int lastColumn)
+                    { gs.tileCache.invalidateColumns(firstColumn, lastColumn); });
+}
+
+/**
+ * @brief The view port centred on the player's simulated position, where the camera ends up once the frame catches up.
+ * The simulation uses this one rather than the camera, so what it does never depends on how frames are drawn.
+ * @param gs The game state.
+ * @return The view port.
+ */
+SDL_FRect simulationView(const GameState &gs)
+{
+    SDL_FRect view = gs.mapViewPort;
+    view.x = (gs.entities.transforms[gs.player()].position.x + TILE_SIZE / 2) - view.w / 2;
+    return view;
+}
+
+/**
+ * @brief Hashes what a replay has to reproduce exactly: every entity's position and velocity, every bullet and every enemy.
+ * @param gs The game state.
+ * @return FNV-1a of the raw bytes, equal only for bit identical states.
+ */
+uint64_t simulationChecksum(const GameState &gs)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const auto add = [&hash](const void *data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ static_cast<const uint8_t *>(data)[i]) * 1099511628211ull;
+        }
     };
+    const EntityStore &es = gs.entities;
+    for (size_t i = 0; i < es.size(); i++)
+    {
+        add(&es.transforms[i].position, sizeof(glm::vec2));
+        add(&es.bodies[i].velocity, sizeof(glm::vec2));
+    }
+    for (const Bullet &bullet : gs.bullets)
+    {
+        add(&bullet.position, sizeof(glm::vec2));
+    }
+    for (size_t i = 0; i < gs.enemies.size(); i++)
+    {
+        const float x = gs.enemies.getX(i);
+        const EnemyState enemyState = gs.enemies.getState(i);
+        add(&x, sizeof(x));
+        add(&enemyState, sizeof(enemyState));
+    }
+    return hash;
+}
+
+/**
+ * @brief Replays a journal as fast as possible without drawing, then checks the result against the recording.
+ * @param state The current SDL application state.
+ * @param gs The game state, set up like when the journal was recorded.
+ * @param res The loaded resources.
+ * @param input The journal to replay.
+ * @return The process exit code: non-zero if the replay did not end where the recording did.
+ */
+int runReplay(const SDLState &state, GameState &gs, const Resources &res, InputJournal &input)
+{
+    const Uint64 start = SDL_GetTicksNS();
+    while (simulateTick(state, gs, res, input, 0))
+    {
+    }
+    const double seconds = (SDL_GetTicksNS() - start) / 1e9;
+
+    const bool matches = simulationChecksum(gs) == input.getHeader().checksum;
+    std::cout << "Replayed " << input.getTick() << " ticks in " << seconds * 1000 << " ms ("
+              << input.getTick() / std::max(seconds, 1e-9) << " ticks/s), "
+              << (matches ? "matching the recording" : "NOT matching the recording") << std::endl;
+    return matches ? 0 : 1;
+}
 
-    const auto loadMap = [&state, &res, &gs](short layer[MAP_ROWS][MAP_COLUMNS])
+/**
+ * @brief Plays what the player did during the last tick: landing, the footsteps of the run animation and enemies shot.
+ * @param gs The game state, right after simulate().
+ * @param audio The mixer.
+ * @param wasGrounded Whether the player stood on something before the tick.
+ */
+void playTickSounds(const GameState &gs, AudioMixer &audio, bool wasGrounded)
+{
+    const size_t player = gs.player(gs.localPlayer);
+    const bool grounded = gs.entities.bodies[player].grounded;
+    if (!wasGrounded && grounded)
     {
-        const auto createObject = [&state](int r, int c, SDL_Texture *tex, ObjectType type)
+        audio.play(ASSET_SOUND_WALL_HIT, 0.5f);
+    }
+
+    const SimChunk &chunk = gs.simChunks[player / SIM_GRAIN];
+    for (const auto &[entity, event] : chunk.events)
+    {
+        if (entity == player && event == ANIM_EVENT_FOOTSTEP && grounded)
         {
-            GameObject o;
-            o.type = type;
-            o.position = glm::vec2(c * TILE_SIZE, state.logical_height - (MAP_ROWS - r) * TILE_SIZE);
-            o.texture = tex;
-            o.collider = {.x = 0, .y = 0, .w = TILE_SIZE, .h = TILE_SIZE};
-            return o;
-        };
+            audio.play(ASSET_SOUND_WALL_HIT, 0.15f);
+        }
+    }
+
+    // one sound each however many were hit in the same tick
+    if (gs.enemies.getDeaths() > 0)
+    {
+        audio.play(ASSET_SOUND_MONSTER_DIE, 0.6f);
+    }
+    else if (gs.enemies.getHits() > 0)
+    {
+        audio.play(ASSET_SOUND_ENEMY_HIT, 0.5f);
+    }
+}
 
-        for (int r = 0; r < MAP_ROWS; r++)
+/**
+ * @brief Moves bullets and plays hit effects. Bullets that hit a solid tile or an enemy turn into a hit effect.
+ * Both pools are walked backwards so despawning, which moves the last object into the hole, skips nothing.
+ * @param gs The game state holding the pools.
+ * @param res The loaded resources.
+ * @param deltaTime Length of the tick in seconds.
+ */
+void updateProjectiles(GameState &gs, const Resources &res, float deltaTime)
+{
+    for (size_t i = gs.bullets.size(); i-- > 0;)
+    {
+        Bullet &bullet = gs.bullets[i];
+        bullet.prevPosition = bullet.position;
+        bullet.position += bullet.velocity * deltaTime;
+        res.animations.step(bullet.animation, deltaTime);
+        bullet.age += deltaTime;
+
+        const bool hit = gs.tiles.isSolid(gs.tiles.rowAt(bullet.position.y), gs.tiles.columnAt(bullet.position.x)) ||
+                         gs.enemies.hitAt(bullet.position);
+        if (hit)
         {
-            for (int c = 0; c < MAP_COLUMNS; c++)
+            Effect effect{.position = bullet.position, .animation = {}, .flipped = bullet.velocity.x < 0};
+            effect.animation.play(res.clipBulletHit);
+            gs.effects.spawn(effect);
+        }
+        if (hit || bullet.age >= BULLET_LIFETIME)
+        {
+            gs.bullets.despawnAt(i);
+        }
+    }
+
+    for (size_t i = gs.effects.size(); i-- > 0;)
+    {
+        Effect &effect = gs.effects[i];
+        res.animations.step(effect.animation, deltaTime);
+        if (effect.animation.finished || effect.animation.clip == NO_CLIP)
+        {
+            gs.effects.despawnAt(i);
+        }
+    }
+}
+
+/**
+ * @brief Creates a player entity standing at a position.
+ * @param gs The game state.
+ * @param res The loaded resources.
+ * @param number Which player it is, its input is the one with this index.
+ * @param position Top left corner of the player.
+ * @return Handle of the new player.
+ */
+EntityHandle createPlayer(GameState &gs, const Resources &res, uint8_t number, glm::vec2 position)
+{
+    EntityStore &es = gs.entities;
+    const EntityHandle handle = es.create(ObjectType::player);
+    const size_t player = es.indexOf(handle);
+
+    Transform &transform = es.transforms[player];
+    transform.position = position;
+    transform.prevPosition = transform.position;
+
+    es.data[player].player = PlayerData();
+    es.data[player].player.number = number;
+
+    es.sprites[player].play(res.clipPlayerIdle);
+
+    PhysicsBody &body = es.bodies[player];
+    body.acceleration = glm::vec2(300, 0);
+    body.maxSpeedX = 100;
+    body.dynamic = true;
+
+    es.colliders[player] = {.x = 11, .y = 6, .w = 10, .h = 26};
+    return handle;
+}
+
+void update(GameState &gs, size_t index, const Resources &res, PlayerInput input, float deltaTime)
+{
+    EntityStore &es = gs.entities;
+    Transform &transform = es.transforms[index];
+    PhysicsBody &body = es.bodies[index];
+    Sprite &sprite = es.sprites[index];
+    PlayerData &player = es.data[index].player;
+
+    float currentDirection = 0;
+
+    // We will do +1 and -1 to make sure that if user has pressed both keys then it will negate each other
+    if (input.held & INPUT_LEFT) // Left Key
+        currentDirection -= 1;
+    if (input.held & INPUT_RIGHT) // Right Direction
+        currentDirection += 1;
+
+    // If the user has pressed a key then assign the direction to the player
+    if (currentDirection)
+        transform.direction = currentDirection;
+
+    switch (player.state)
+    {
+    case PlayerState::idle:
+        if (currentDirection)
+        {
+            player.state = PlayerState::running;
+        }
+        else
+        {
+            // decelarate
+            if (body.velocity.x)
             {
-                switch (layer[r][c])
-                {
-                case 1:
-                {
-                    GameObject o = createObject(r, c, res.ground, ObjectType::level);
-                    gs.layers[LAYER_IDX_LEVEL].push_back(o);
-                    break;
-                }
-                case 2:
-                {
-                    GameObject o = createObject(r, c, res.panel, ObjectType::level);
-                    gs.layers[LAYER_IDX_LEVEL].push_back(o);
-                    break;
-                }
-                case 4: // This is the player cases
+                // if the velocity is positive i.e. in the right direction we use a negative factor and vice-versa
+                const float factor = body.velocity.x > 0 ? -1.5f : 1.5f;
+                float amount = factor * body.acceleration.x * deltaTime;
+
+                // if velocity is already less than amount than further decelaration is not possible so we set it to 0
+                if (std::abs(body.velocity.x) < std::abs(amount))
+                    body.velocity.x = 0;
+                else
+                    body.velocity.x += amount; // amount will be always inverse to velocity because of factor so we add it
+            }
+        }
+        sprite.play(res.clipPlayerIdle);
+        break;
+    case PlayerState::running:
+        if (!currentDirection)
+        {
+            player.state = PlayerState::idle;
+        }
+
+        // moving in opposite direction will make a sliding
+        if (body.velocity.x * transform.direction < 0 && body.grounded)
+        {
+            sprite.play(res.clipPlayerSlide);
+        }
+        else
+        {
+            sprite.play(res.clipPlayerRun);
+        }
+        break;
+    case PlayerState::jumping:
+        sprite.play(res.clipPlayerRun);
+        break;
+    }
+
+    // Keep firing while the shoot key is held
+    player.shootCooldown -= deltaTime;
+    if ((input.held & INPUT_SHOOT) && player.shootCooldown <= 0)
+    {
+        player.shootCooldown = SHOOT_INTERVAL;
+        const glm::vec2 muzzle = transform.position + glm::vec2(transform.direction > 0 ? 24 : 4, 17);
+        Bullet bullet{
+            .position = muzzle,
+            .prevPosition = muzzle,
+            .velocity = glm::vec2(BULLET_SPEED * transform.direction, 0),
+            .animation = {},
+            .age = 0};
+        bullet.animation.play(res.clipBullet);
+        gs.bullets.spawn(bullet);
+    }
+
+    // This is to calculate velocity of the object
+    body.velocity += currentDirection * body.acceleration * deltaTime;
+
+    // If the velocity is greater than max speed than reduce it to max speed
+    // we use absolute value because velocity can be negative for currentDirection = -1
+    if (std::abs(body.velocity.x) > body.maxSpeedX)
+        body.velocity.x = body.maxSpeedX * currentDirection;
+}
+
+/**
+ * @brief Applies gravity and moves every entity by its velocity, streaming through the body and transform arrays.
+ * @param gs The game state holding the entities.
+ * @param deltaTime Length of the tick in seconds.
+ */
+void integrate(GameState &gs, float deltaTime)
+{
+    EntityStore &es = gs.entities;
+    gs.jobs.parallelFor(es.size(), SIM_GRAIN, [&es, deltaTime](size_t begin, size_t end)
+                        {
+        for (size_t i = begin; i < end; i++)
+        {
+            PhysicsBody &body = es.bodies[i];
+            if (body.dynamic)
+            {
+                // Apply Some Gravity
+                body.velocity += glm::vec2(0, 500) * deltaTime;
+            }
+            es.transforms[i].position += body.velocity * deltaTime;
+        } });
+}
+
+/**
+ * @brief Resolve phase for one moving entity: sweeps it from where it was at the start of the tick against the
+ * level tiles the narrowphase found, stopping at the first hit and sliding along it for the rest of the tick, then
+ * pushes it out of the entities it overlaps. Grounded comes from the normals of those contacts.
+ * Only this entity is written to, everything else is read from the contacts, so entities can be resolved in parallel.
+ * @param state The current SDL application state.
+ * @param gs The game state, with the contacts of this tick found.
+ * @param index The entity to resolve.
+ * @param res The loaded resources.
+ * @param deltaTime Length of the tick in seconds.
+ */
+void resolveCollisions(const SDLState &state, GameState &gs, size_t index, const Resources &res, float deltaTime)
+{
+    EntityStore &es = gs.entities;
+    Transform &transform = es.transforms[index];
+    PhysicsBody &body = es.bodies[index];
+    const SDL_FRect &collider = es.colliders[index];
+    const SimChunk &chunk = gs.simChunks[index / SIM_GRAIN];
+    bool foundGround = false;
+
+    SDL_FRect box{
+        .x = transform.prevPosition.x + collider.x,
+        .y = transform.prevPosition.y + collider.y,
+        .w = collider.w,
+        .h = collider.h};
+    glm::vec2 remaining = transform.position - transform.prevPosition;
+    for (int hit = 0; hit < MAX_SWEEP_HITS; hit++)
+    {
+        // earliest tile on the way; of those already overlapping, the deepest
+        ContactManifold first{};
+        const SDL_FRect *obstacle = nullptr;
+        for (uint32_t k = gs.contactBegin[index]; k < gs.contactEnd[index]; k++)
+        {
+            const Contact &contact = chunk.contacts[k];
+            ContactManifold manifold;
+            if (contact.other < 0 && sweepAabb(box, remaining, contact.rect, manifold) &&
+                (!obstacle || manifold.toi < first.toi ||
+                 (manifold.toi == first.toi && manifold.penetration > first.penetration)))
+            {
+                first = manifold;
+                obstacle = &contact.rect;
+            }
+        }
+        if (!obstacle)
+        {
+            break;
+        }
+
+        // move up to the obstacle and put the box flush against the face that was hit
+        box.x += remaining.x * first.toi;
+        box.y += remaining.y * first.toi;
+        remaining *= 1 - first.toi;
+        if (first.normal.x != 0)
+        {
+            box.x = first.normal.x < 0 ? obstacle->x - box.w : obstacle->x + obstacle->w;
+        }
+        else
+        {
+            box.y = first.normal.y < 0 ? obstacle->y - box.h : obstacle->y + obstacle->h;
+        }
+
+        // whatever motion was going into it is stopped, the rest slides along it
+        const float into = glm::dot(remaining, first.normal);
+        if (into < 0)
+        {
+            remaining -= first.normal * into;
+        }
+        const float speedInto = glm::dot(body.velocity, first.normal);
+        if (speedInto < 0)
+        {
+            body.velocity -= first.normal * speedInto;
+        }
+        if (first.normal.y < 0)
+        {
+            foundGround = true;
+        }
+    }
+    transform.position = {box.x + remaining.x - collider.x, box.y + remaining.y - collider.y};
+
+    for (uint32_t k = gs.contactBegin[index]; k < gs.contactEnd[index]; k++)
+    {
+        const Contact &contact = chunk.contacts[k];
+        ContactManifold manifold;
+        if (contact.other >= 0 && checkCollision(state, gs, res, index, contact, manifold, deltaTime) &&
+            manifold.normal.y < 0)
+        {
+            foundGround = true;
+        }
+    }
+
+    if (body.grounded != foundGround)
+    {
+        // We are changing the state
+        body.grounded = foundGround;
+        if (foundGround && es.types[index] == ObjectType::player)
+        {
+            es.data[index].player.state = PlayerState::running;
+        }
+    }
+}
+
+// Only ever changes entity a, see resolveCollisions(); true if a was pushed out of b
+bool collisionResponse(const SDLState &state, GameState &gs, const Resources &res, const ContactManifold &manifold, size_t a, size_t b, float deltaTime)
+{
+    // entities are solid to each other, players and enemies alike
+    EntityStore &es = gs.entities;
+    separateBodies(es.transforms[a], es.bodies[a], manifold);
+    return true;
+}
+
+/**
+ * @brief Moves an entity half way out of another one along the contact normal and stops its motion into it.
+ * The other entity is moved the other half when it is resolved, from the same contact seen from its side.
+ * @param transform Transform of the entity to move.
+ * @param body Physics body of the entity to move.
+ * @param manifold The contact, with the normal pointing towards the entity.
+ */
+void separateBodies(Transform &transform, PhysicsBody &body, const ContactManifold &manifold)
+{
+    transform.position += manifold.normal * (manifold.penetration * 0.5f);
+    const float speedInto = glm::dot(body.velocity, manifold.normal);
+    if (speedInto < 0)
+    {
+        body.velocity -= manifold.normal * speedInto;
+    }
+}
+
+/**
+ * @brief Overlap test of entity a against another entity it may be touching, handing hits to collisionResponse().
+ * @param manifold Filled in when they overlap.
+ * @return True if the response pushed a out.
+ */
+bool checkCollision(const SDLState &state, GameState &gs, const Resources &res, size_t a, const Contact &contact, ContactManifold &manifold, float deltaTime)
+{
+    SDL_FRect rectA = getBounds(gs.entities, a);
+    if (overlapAabb(rectA, contact.rect, manifold))
+    {
+        return collisionResponse(state, gs, res, manifold, a, contact.other, deltaTime);
+    }
+    return false;
+}
+
+/**
+ * @brief Builds the tile map and spawns the player.
+ * @param state The current SDL application state.
+ * @param gs The game state to fill.
+ * @param res The loaded resources.
+ * @param columns Width of the built in level in tiles. Wider levels repeat it, with the player only in the first copy.
+ * @param levelPath Level file to stream instead of the built in level; the built in level is used if it cannot be opened.
+ */
+void createTiles(const SDLState &state, GameState &gs, const Resources &res, int columns, const char *levelPath)
+{
+    int spawnRow = -1, spawnColumn = -1;
+    if (levelPath[0] != '\0' && gs.level.open(levelPath))
+    {
+        // Only the chunks around the player are copied in now, the rest follows the camera
+        const LevelHeader &header = gs.level.getHeader();
+        gs.level.attach(gs.tiles, TILE_SIZE,
+                        SDL_FPoint{0, static_cast<float>(state.logical_height - static_cast<int>(header.rows) * TILE_SIZE)},
+                        gs.mapViewPort.w, LEVEL_KEEP_CHUNKS);
+        spawnRow = header.spawnRow;
+        spawnColumn = header.spawnColumn;
+        gs.mapViewPort.x = (spawnColumn + 0.5f) * TILE_SIZE - gs.mapViewPort.w / 2;
+        gs.level.stream(gs.tiles, gs.mapViewPort, [&gs](int firstColumn, int lastColumn)
+                        { gs.tileCache.invalidateColumns(firstColumn, lastColumn); });
+    }
+    else
+    {
+        // Every chunk of the built in level is resident for good
+        gs.tiles.resize(MAP_ROWS, columns, TILE_SIZE,
+                        SDL_FPoint{0, static_cast<float>(state.logical_height - MAP_ROWS * TILE_SIZE)});
+        for (size_t layer = 0; layer < TILE_LAYER_COUNT; layer++)
+        {
+            for (int r = 0; r < MAP_ROWS; r++)
+            {
+                for (int c = 0; c < columns; c++)
                 {
-                    GameObject player;
-                    player = createObject(r, c, res.idle_texture, ObjectType::player);
-                    player.data.player = PlayerData();
-                    player.texture = res.idle_texture;
-                    player.animations = res.playerAnims;
-                    player.currentAnimation = res.ANIM_PLAYER_IDLE;
-                    player.acceleration = glm::vec2(300, 0);
-                    player.maxSpeedX = 100;
-                    player.dynamic = true;
-                    player.collider = {.x = 11, .y = 6, .w = 10, .h = 26};
-                    gs.layers[LAYER_IDX_CHARACTERS].push_back(player);
-                    gs.playerIndex = gs.layers[LAYER_IDX_CHARACTERS].size() - 1;
-                    break;
+                    const uint8_t cell = builtInTile(static_cast<TileLayer>(layer), r, c);
+                    if (cell == TILE_PLAYER)
+                    {
+                        spawnRow = r;
+                        spawnColumn = c;
+                    }
+                    else if (cell != TILE_ENEMY) // spawned below, once the tiles they stand on are in
+                    {
+                        gs.tiles.set(static_cast<TileLayer>(layer), r, c, cell);
+                    }
                 }
-                case 5:
+            }
+        }
+    }
+
+    // Tiles keep their map value as tile ID, everything about them lives in the tile map's property table
+    gs.tiles.setProperties(1, {.image = res.get(ASSET_GROUND), .solid = true});
+    gs.tiles.setProperties(2, {.image = res.get(ASSET_PANEL), .solid = true});
+    gs.tiles.setProperties(5, {.image = res.get(ASSET_GRASS), .solid = false});
+    gs.tiles.setProperties(6, {.image = res.get(ASSET_BRICK), .solid = false});
+
+    // Enemies of the whole level at once; the ones far from the player cost nothing until it gets close
+    gs.enemies.clear();
+    gs.enemies.setClips(res.clipEnemy, res.clipEnemyHit, res.clipEnemyDie);
+    const int rows = gs.tiles.getRows();
+    const auto isSolid = [&gs](int r, int c)
+    { return isLevelSolid(gs, r, c); };
+    if (gs.level.isOpen())
+    {
+        for (uint32_t i = 0; i < gs.level.getHeader().enemyCount; i++)
+        {
+            const LevelSpawn &spawn = gs.level.getEnemies()[i];
+            gs.enemies.spawn(spawn.row, spawn.column, rows, gs.tiles.getColumns(), gs.tiles.getOrigin(), TILE_SIZE, isSolid);
+        }
+    }
+    else
+    {
+        for (int c = 0; c < columns; c++)
+        {
+            for (int r = 0; r < rows; r++)
+            {
+                if (builtInTile(TileLayer::level, r, c) == TILE_ENEMY)
                 {
-                    GameObject o = createObject(r, c, res.grass, ObjectType::level);
-                    gs.foregroundTiles.push_back(o);
-                    break;
+                    gs.enemies.spawn(r, c, rows, columns, gs.tiles.getOrigin(), TILE_SIZE, isSolid);
                 }
-                case 6:
+            }
+        }
+    }
+    gs.enemies.finishSpawning();
+
+    // This is the player
+    assert(spawnRow >= 0);
+    const SDL_FPoint origin = gs.tiles.getOrigin();
+    gs.playerHandles[0] = createPlayer(gs, res, 0, glm::vec2(origin.x + spawnColumn * TILE_SIZE, origin.y + spawnRow * TILE_SIZE));
+}
+
+/**
+ * @brief Whether a level cell is solid, resident or not: a streamed level's cells are read from the file.
+ * @param gs The game state holding the level.
+ * @param row Row of the cell.
+ * @param column Column of the cell.
+ * @return True for a solid tile.
+ */
+bool isLevelSolid(const GameState &gs, int row, int column)
+{
+    if (gs.level.isOpen())
+    {
+        return gs.tiles.getProperties(gs.level.tileAt(TileLayer::level, row, column)).solid;
+    }
+    return gs.tiles.isSolid(row, column);
+}
+
+/**
+ * @brief Registers every moving entity with the broadphase and finds their pairs for this tick.
+ * @param gs The game state holding the entities, already integrated for this tick.
+ */
+void updateBroadphase(GameState &gs)
+{
+    const EntityStore &es = gs.entities;
+    gs.sweptBounds.resize(es.size());
+    gs.jobs.parallelFor(es.size(), SIM_GRAIN, [&gs, &es](size_t begin, size_t end)
+                        {
+        for (size_t i = begin; i < end; i++)
+        {
+            // union of where the collider was last tick and where it is now
+            SDL_FRect now = getBounds(es, i);
+            SDL_FRect before = now;
+            before.x += es.transforms[i].prevPosition.x - es.transforms[i].position.x;
+            before.y += es.transforms[i].prevPosition.y - es.transforms[i].position.y;
+            SDL_GetRectUnionFloat(&before, &now, &gs.sweptBounds[i]);
+        } });
+
+    // the sweep and prune itself keeps its sort order between ticks and stays on this thread
+    gs.broadphase.reserve(es.size(), CONTACTS_PER_BODY);
+    gs.broadphase.beginFrame();
+    for (size_t i = 0; i < es.size(); i++)
+    {
+        if (es.bodies[i].dynamic)
+        {
+            gs.broadphase.addDynamic(static_cast<int>(i), gs.sweptBounds[i]);
+        }
+    }
+    gs.broadphase.findDynamicPairs();
+}
+
+/**
+ * @brief Narrowphase: collects, for every moving entity, the solid tiles and entities its bounds touch.
+ * Runs in parallel; positions are only read here, and each range writes to its own SimChunk.
+ * @param gs The game state, with the broadphase updated for this tick.
+ */
+void findContacts(GameState &gs)
+{
+    const EntityStore &es = gs.entities;
+    const size_t chunkCount = (es.size() + SIM_GRAIN - 1) / SIM_GRAIN;
+    if (gs.simChunks.size() < chunkCount)
+    {
+        gs.simChunks.resize(chunkCount);
+    }
+    gs.contactBegin.resize(es.size());
+    gs.contactEnd.resize(es.size());
+
+    gs.jobs.parallelFor(es.size(), SIM_GRAIN, [&gs, &es](size_t begin, size_t end)
+                        {
+        SimChunk &chunk = gs.simChunks[begin / SIM_GRAIN];
+        chunk.contacts.clear();
+        chunk.candidatePairs = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            gs.contactBegin[i] = static_cast<uint32_t>(chunk.contacts.size());
+            if (es.bodies[i].dynamic)
+            {
+                // everything the collider passed over this tick, so fast bodies cannot skip a tile
+                const SDL_FRect &bounds = gs.sweptBounds[i];
+
+                // level tiles are looked up directly in the tile map
+                gs.tiles.forEachCell(TileLayer::level, bounds, [&](int r, int c, uint8_t id)
+                                     {
+                    if (gs.tiles.getProperties(id).solid)
+                    {
+                        chunk.contacts.push_back({-1, gs.tiles.cellRect(r, c)});
+                    } });
+
+                // other entities come from the broadphase
+                chunk.candidates.clear();
+                gs.broadphase.query(static_cast<int>(i), chunk.candidates);
+                chunk.candidatePairs += chunk.candidates.size();
+                for (int other : chunk.candidates)
                 {
-                    GameObject o = createObject(r, c, res.brick, ObjectType::level);
-                    gs.backgroundTiles.push_back(o);
-                    break;
-                }
+                    if (static_cast<size_t>(other) != i)
+                    {
+                        chunk.contacts.push_back({other, getBounds(es, other)});
+                    }
                 }
             }
-        }
-    };
-    loadMap(map);
-    loadMap(background);
-    loadMap(foreground);
-    assert(gs.playerIndex != -1);
+            gs.contactEnd[i] = static_cast<uint32_t>(chunk.contacts.size());
+        } });
+
+    for (size_t c = 0; c < chunkCount; c++)
+    {
+        gs.broadphase.addCandidatePairs(gs.simChunks[c].candidatePairs);
+    }
 }
 
-void handleKeyInput(const SDLState &state, GameState &gs, GameObject &obj, SDL_Scancode key, bool keyDown)
+SDL_FRect getBounds(const EntityStore &entities, size_t index)
+{
+    const glm::vec2 &position = entities.transforms[index].position;
+    const SDL_FRect &collider = entities.colliders[index];
+    return SDL_FRect{
+        .x = position.x + collider.x,
+        .y = position.y + collider.y,
+        .w = collider.w,
+        .h = collider.h};
+}
+
+void handleKeyInput(const SDLState &state, GameState &gs, size_t index, SDL_Scancode key, bool keyDown)
 {
     const float JumpForce = -200.0f; // this is negative to make the player go up when they jump
 
-    if (obj.type == ObjectType::player)
+    EntityStore &es = gs.entities;
+    if (es.types[index] == ObjectType::player)
     {
-        switch (obj.data.player.state)
+        PlayerData &player = es.data[index].player;
+        PhysicsBody &body = es.bodies[index];
+        switch (player.state)
         {
         case PlayerState::idle:
         {
             if (key == SDL_SCANCODE_SPACE && keyDown)
             {
-                obj.data.player.state = PlayerState::jumping;
-                obj.velocity.y += JumpForce;
+                player.state = PlayerState::jumping;
+                body.velocity.y += JumpForce;
             }
             break;
         }
@@ -666,28 +2397,11 @@ void handleKeyInput(const SDLState &state, GameState &gs, GameObject &obj, SDL_S
         {
             if (key == SDL_SCANCODE_SPACE && keyDown)
             {
-                obj.data.player.state = PlayerState::jumping;
-                obj.velocity.y += JumpForce;
+                player.state = PlayerState::jumping;
+                body.velocity.y += JumpForce;
             }
             break;
         }
         }
     }
-}
-
-void drawParralaxBackground(SDL_Renderer *renderer, SDL_Texture *texture, float xVelocity, float &scrollPos, float scrollFactor, float deltaTime)
-{
-    scrollPos -= xVelocity * scrollFactor * deltaTime;
-    if (scrollPos <= -texture->w)
-    {
-        scrollPos = 0;
-    }
-
-    SDL_FRect dst{
-        .x = scrollPos,
-        .y = 68,
-        .w = texture->w * 2.0f, // the width is 2 times because we want to draw the texture twice
-        .h = static_cast<float>(texture->h)};
-
-    SDL_RenderTextureTiled(renderer, texture, nullptr, 1, &dst);
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file; pages are only read from disk when touched
+class MappedFile
+{
+    const uint8_t *bytes;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+
+public:
+#ifdef _WIN32
+    MappedFile() : bytes(nullptr), length(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {}
+#else
+    MappedFile() : bytes(nullptr), length(0) {}
+#endif
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const char *path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            close();
+            return false;
+        }
+        bytes = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        length = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (p == MAP_FAILED)
+        {
+            return false;
+        }
+        bytes = static_cast<const uint8_t *>(p);
+        length = static_cast<size_t>(st.st_size);
+#endif
+        if (!bytes)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes)
+            munmap(const_cast<uint8_t *>(bytes), length);
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    bool isOpen() const { return bytes != nullptr; }
+    const uint8_t *data() const { return bytes; }
+    size_t size() const { return length; }
+};
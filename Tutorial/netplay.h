@@ -0,0 +1,463 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "gameObject.h"
+#include "snapshot.h"
+
+#ifdef _WIN32
+using NetSocket = SOCKET;
+const NetSocket NO_SOCKET = INVALID_SOCKET;
+#else
+using NetSocket = int;
+const NetSocket NO_SOCKET = -1;
+#endif
+
+const size_t NET_MAX_PACKET = 512;
+
+/*
+ * Unreliable datagrams to and from the other player: over a UDP socket, or over an in-process loopback
+ * that hands packets to another NetLink in the same process once a set latency has passed, to play
+ * against a second simulation without a network. Packets may get lost either way (the loopback drops
+ * them when too many are on their way), so whatever is sent has to be sent again until it is known to
+ * have arrived.
+ */
+class NetLink
+{
+    struct Packet
+    {
+        Uint64 arrival; // SDL_GetTicksNS() from when it can be received
+        size_t size;
+        std::array<uint8_t, NET_MAX_PACKET> data;
+    };
+
+    // Packets on their way from one end of a loopback to the other, oldest first
+    struct Wire
+    {
+        std::mutex mutex;
+        std::array<Packet, 64> packets;
+        size_t head = 0, count = 0;
+    };
+
+    std::shared_ptr<Wire> outgoing, incoming;
+    Uint64 latencyNS = 0;
+
+    NetSocket socket = NO_SOCKET;
+    sockaddr_in peer{};
+
+public:
+    NetLink() = default;
+    ~NetLink() { close(); }
+
+    NetLink(const NetLink &) = delete;
+    NetLink &operator=(const NetLink &) = delete;
+
+    bool isOpen() const { return outgoing || socket != NO_SOCKET; }
+
+    // Connects two links in this process; what one sends the other receives latencyNS later
+    static void connectLoopback(NetLink &a, NetLink &b, Uint64 latencyNS)
+    {
+        a.close();
+        b.close();
+        a.outgoing = b.incoming = std::make_shared<Wire>();
+        b.outgoing = a.incoming = std::make_shared<Wire>();
+        a.latencyNS = b.latencyNS = latencyNS;
+    }
+
+    /**
+     * @brief Opens a UDP socket on localPort that talks to host:remotePort, and only to it.
+     * @param localPort Port to receive on.
+     * @param host Name or IPv4 address of the other player.
+     * @param remotePort Port the other player receives on.
+     * @return False if the host is unknown or the port cannot be bound.
+     */
+    bool openUdp(uint16_t localPort, const std::string &host, uint16_t remotePort)
+    {
+        close();
+#ifdef _WIN32
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+        {
+            return false;
+        }
+#endif
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo *found = nullptr;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || !found)
+        {
+            SDL_Log("Unknown host %s", host.c_str());
+            close();
+            return false;
+        }
+        std::memcpy(&peer, found->ai_addr, sizeof(peer));
+        freeaddrinfo(found);
+        peer.sin_port = htons(remotePort);
+
+        socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(localPort);
+        if (socket == NO_SOCKET || bind(socket, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) != 0)
+        {
+            SDL_Log("Cannot listen on UDP port %u", localPort);
+            close();
+            return false;
+        }
+
+        // receive() polls once a tick, it must never block
+#ifdef _WIN32
+        u_long nonBlocking = 1;
+        ioctlsocket(socket, FIONBIO, &nonBlocking);
+#else
+        fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+        return true;
+    }
+
+    void close()
+    {
+        outgoing.reset();
+        incoming.reset();
+        if (socket != NO_SOCKET)
+        {
+#ifdef _WIN32
+            closesocket(socket);
+            WSACleanup();
+#else
+            ::close(socket);
+#endif
+            socket = NO_SOCKET;
+        }
+    }
+
+    // Sends one datagram of at most NET_MAX_PACKET bytes, or drops it
+    void send(const void *data, size_t size)
+    {
+        if (size > NET_MAX_PACKET)
+        {
+            return;
+        }
+        if (outgoing)
+        {
+            std::lock_guard lock(outgoing->mutex);
+            if (outgoing->count < outgoing->packets.size())
+            {
+                Packet &packet = outgoing->packets[(outgoing->head + outgoing->count++) % outgoing->packets.size()];
+                packet.arrival = SDL_GetTicksNS() + latencyNS;
+                packet.size = size;
+                std::memcpy(packet.data.data(), data, size);
+            }
+        }
+        else if (socket != NO_SOCKET)
+        {
+            sendto(socket, static_cast<const char *>(data), static_cast<int>(size), 0,
+                   reinterpret_cast<const sockaddr *>(&peer), sizeof(peer));
+        }
+    }
+
+    // Takes the next datagram that has arrived; returns its size, 0 when there is none
+    size_t receive(void *data, size_t capacity)
+    {
+        if (incoming)
+        {
+            std::lock_guard lock(incoming->mutex);
+            if (incoming->count == 0 || incoming->packets[incoming->head].arrival > SDL_GetTicksNS())
+            {
+                return 0;
+            }
+            const Packet &packet = incoming->packets[incoming->head];
+            incoming->head = (incoming->head + 1) % incoming->packets.size();
+            incoming->count--;
+            const size_t size = std::min(packet.size, capacity);
+            std::memcpy(data, packet.data.data(), size);
+            return size;
+        }
+        while (socket != NO_SOCKET)
+        {
+            sockaddr_in from{};
+            socklen_t fromSize = sizeof(from);
+            const auto size = recvfrom(socket, static_cast<char *>(data), static_cast<int>(capacity), 0,
+                                       reinterpret_cast<sockaddr *>(&from), &fromSize);
+            if (size <= 0)
+            {
+                return 0;
+            }
+            // anyone else sending to this port is ignored
+            if (from.sin_addr.s_addr == peer.sin_addr.s_addr && from.sin_port == peer.sin_port)
+            {
+                return static_cast<size_t>(size);
+            }
+        }
+        return 0;
+    }
+};
+
+const uint32_t ROLLBACK_MAX_TICKS = 12;  // furthest a session runs ahead of the other player's input, and so its longest rollback
+const uint32_t NET_INPUT_HISTORY = 64;   // ticks of input kept, for resending and rolling back
+const uint32_t NET_PACKET_INPUTS = 32;   // ticks of input sent in one packet at most
+const uint32_t NO_TICK = UINT32_MAX;
+const char NET_MAGIC[4] = {'R', 'B', 'N', '2'};
+
+// One datagram of a session, little endian like everything else the game writes
+struct InputPacket
+{
+    char magic[4];
+    uint32_t firstTick;    // tick of inputs[0]
+    uint32_t ack;          // the sender has the receiver's input for every tick before this one
+    uint32_t checksumTick; // a tick whose state the sender simulated on confirmed input only, or NO_TICK
+    uint64_t checksum;     // of the state at its start
+    uint8_t player;        // which player the sender controls
+    uint8_t count;
+    PlayerInput inputs[NET_PACKET_INPUTS]; // only 'count' of them are sent
+};
+
+struct RollbackStats
+{
+    uint32_t tick = 0;            // ticks simulated
+    uint32_t remoteTick = 0;      // the other player's input is known up to here
+    uint32_t rollbacks = 0;
+    uint32_t lastRollbackTicks = 0, maxRollbackTicks = 0; // ticks simulated again
+    float lastRollbackMs = 0, maxRollbackMs = 0;
+    uint32_t stalls = 0;          // ticks spent waiting for the other player
+    uint32_t desyncs = 0;         // checksums that did not match the other player's
+    uint32_t refused = 0;         // packets from a side that controls the same player as this one
+};
+
+/*
+ * Rollback netplay for two players. Every tick runs at once on the local input and a guess of the other
+ * player's: whatever they held last, and no new presses. The other player's real input arrives a few
+ * ticks later, and when it differs from the guess the session goes back to the snapshot of the first
+ * wrong tick and simulates every tick since again, without drawing any of them. Snapshots are taken at
+ * the start of every tick into a ring, far enough back for the longest rollback allowed; a session
+ * ROLLBACK_MAX_TICKS ahead of the other player's input waits for it instead of guessing further.
+ *
+ * Each packet carries all local input the other side has not acknowledged yet, so lost packets cost
+ * nothing but a longer rollback, and the checksum of the newest tick simulated on confirmed input only:
+ * both sides must have the same one, a mismatch is a desync. The checksum is the hash of the tick's
+ * snapshot, so it covers everything a rollback restores. Packets also say which player the sender
+ * controls; packets from a side that controls the same player as this one are refused.
+ *
+ * Game is anything with save(Snapshot &), load(Snapshot &) and step(const PlayerInput *),
+ * which simulates one tick on the input of each player in turn. Stepping must only depend on the state
+ * saved and the inputs, or rolling back changes the outcome.
+ */
+class RollbackSession
+{
+    NetLink &link;
+    size_t localPlayer, remotePlayer;
+    std::array<std::array<PlayerInput, MAX_PLAYERS>, NET_INPUT_HISTORY> inputs{}; // by tick
+    std::array<uint64_t, NET_INPUT_HISTORY> checksums{};                           // at the start of each tick
+    SnapshotRing snapshots;
+    uint32_t tick = 0;        // next tick to simulate
+    uint32_t remoteTicks = 0; // the other player's input is known for every tick before this one
+    uint32_t remoteAck = 0;   // and they know ours for every tick before this one
+    uint8_t waitingPresses = 0; // presses of ticks that waited, kept for the next tick that runs
+    uint32_t remoteChecksumTick = NO_TICK;
+    uint64_t remoteChecksum = 0;
+    RollbackStats stats;
+
+    PlayerInput &input(uint32_t t, size_t player) { return inputs[t % NET_INPUT_HISTORY][player]; }
+
+    PlayerInput predict()
+    {
+        PlayerInput guess = remoteTicks > 0 ? input(remoteTicks - 1, remotePlayer) : PlayerInput();
+        guess.pressed = 0;
+        return guess;
+    }
+
+    template <typename Game>
+    void step(Game &game, uint32_t t)
+    {
+        if (t >= remoteTicks)
+        {
+            input(t, remotePlayer) = predict();
+        }
+        Snapshot &snapshot = snapshots.at(t);
+        snapshot.begin(t);
+        game.save(snapshot);
+        snapshot.checksum = snapshot.hash();
+        checksums[t % NET_INPUT_HISTORY] = snapshot.checksum;
+        game.step(inputs[t % NET_INPUT_HISTORY].data());
+    }
+
+    // Takes in every packet that has arrived; returns the first tick that was simulated on a wrong guess, or NO_TICK
+    uint32_t receive()
+    {
+        uint32_t mispredicted = NO_TICK;
+        InputPacket packet;
+        const size_t header = offsetof(InputPacket, inputs);
+        while (const size_t size = link.receive(&packet, sizeof(packet)))
+        {
+            if (size < header || std::memcmp(packet.magic, NET_MAGIC, 4) != 0 || packet.count > NET_PACKET_INPUTS ||
+                size < header + packet.count * sizeof(PlayerInput))
+            {
+                continue;
+            }
+            if (packet.player != remotePlayer)
+            {
+                if (stats.refused++ == 0)
+                {
+                    SDL_Log("Refusing netplay packets: the other side runs with --netplay-player %u, it has to use %u",
+                            static_cast<unsigned>(packet.player), static_cast<unsigned>(remotePlayer));
+                }
+                continue;
+            }
+            remoteAck = std::clamp(packet.ack, remoteAck, tick);
+            if (packet.checksumTick != NO_TICK && (remoteChecksumTick == NO_TICK || packet.checksumTick > remoteChecksumTick))
+            {
+                remoteChecksumTick = packet.checksumTick;
+                remoteChecksum = packet.checksum;
+            }
+            // ticks already known are skipped, ticks after a gap wait for the packet that fills it to be sent again
+            for (uint32_t i = 0; i < packet.count && packet.firstTick + i <= remoteTicks; i++)
+            {
+                const uint32_t t = packet.firstTick + i;
+                if (t < remoteTicks || remoteTicks >= tick + ROLLBACK_MAX_TICKS)
+                {
+                    continue;
+                }
+                if (t < tick && input(t, remotePlayer) != packet.inputs[i])
+                {
+                    mispredicted = std::min(mispredicted, t);
+                }
+                input(t, remotePlayer) = packet.inputs[i];
+                remoteTicks++;
+            }
+        }
+        return mispredicted;
+    }
+
+    template <typename Game>
+    void rollback(Game &game, uint32_t from)
+    {
+        Snapshot *snapshot = snapshots.find(from);
+        if (!snapshot)
+        {
+            SDL_Log("Cannot roll back to tick %u, its snapshot is gone", from);
+            return;
+        }
+        const Uint64 start = SDL_GetTicksNS();
+        game.load(*snapshot);
+        for (uint32_t t = from; t < tick; t++)
+        {
+            step(game, t);
+        }
+        stats.rollbacks++;
+        stats.lastRollbackTicks = tick - from;
+        stats.lastRollbackMs = (SDL_GetTicksNS() - start) / 1e6f;
+        stats.maxRollbackTicks = std::max(stats.maxRollbackTicks, stats.lastRollbackTicks);
+        stats.maxRollbackMs = std::max(stats.maxRollbackMs, stats.lastRollbackMs);
+    }
+
+    // Compares the other player's checksum with ours for the same tick, once ours is final as well
+    void checkDesync()
+    {
+        const uint32_t t = remoteChecksumTick;
+        if (t == NO_TICK || t >= tick || t > remoteTicks)
+        {
+            return;
+        }
+        if (tick - t < NET_INPUT_HISTORY && checksums[t % NET_INPUT_HISTORY] != remoteChecksum)
+        {
+            if (stats.desyncs++ == 0)
+            {
+                SDL_Log("Desync at tick %u: the other player's simulation differs from this one", t);
+            }
+        }
+        remoteChecksumTick = NO_TICK;
+    }
+
+    void send()
+    {
+        InputPacket packet;
+        std::memcpy(packet.magic, NET_MAGIC, 4);
+        packet.player = static_cast<uint8_t>(localPlayer);
+        packet.firstTick = remoteAck;
+        packet.ack = remoteTicks;
+        // the state at the start of a tick is final once the other player's input before it is all known
+        packet.checksumTick = tick > 0 ? std::min(remoteTicks, tick - 1) : NO_TICK;
+        packet.checksum = tick > 0 ? checksums[packet.checksumTick % NET_INPUT_HISTORY] : 0;
+        packet.count = static_cast<uint8_t>(std::min(tick - remoteAck, NET_PACKET_INPUTS));
+        for (uint32_t i = 0; i < packet.count; i++)
+        {
+            packet.inputs[i] = input(packet.firstTick + i, localPlayer);
+        }
+        link.send(&packet, offsetof(InputPacket, inputs) + packet.count * sizeof(PlayerInput));
+    }
+
+public:
+    /**
+     * @param link Connected to the other player's session.
+     * @param localPlayer Which player this machine controls, 0 or 1; the other side must use the other one.
+     */
+    RollbackSession(NetLink &link, size_t localPlayer)
+        : link(link), localPlayer(localPlayer), remotePlayer(1 - localPlayer), snapshots(ROLLBACK_MAX_TICKS + 1)
+    {
+    }
+
+    RollbackSession(const RollbackSession &) = delete;
+    RollbackSession &operator=(const RollbackSession &) = delete;
+
+    uint32_t getTick() const { return tick; }
+    size_t getLocalPlayer() const { return localPlayer; }
+    const RollbackStats &getStats() const { return stats; }
+
+    /**
+     * @brief Runs the next tick on the local input, after rolling back for whatever input of the other player arrived.
+     * @param local What the local player does this tick.
+     * @param game The simulation, see the class comment.
+     * @return False if the tick had to wait for the other player; the local presses are kept for the next one.
+     */
+    template <typename Game>
+    bool advance(PlayerInput local, Game &game)
+    {
+        const uint32_t mispredicted = receive();
+        if (mispredicted != NO_TICK)
+        {
+            rollback(game, mispredicted);
+        }
+        checkDesync();
+
+        local.pressed |= waitingPresses;
+        const bool waits = tick >= remoteTicks + ROLLBACK_MAX_TICKS;
+        if (!waits)
+        {
+            input(tick, localPlayer) = local;
+            step(game, tick);
+            tick++;
+        }
+        waitingPresses = waits ? local.pressed : 0;
+        stats.stalls += waits;
+        stats.tick = tick;
+        stats.remoteTick = remoteTicks;
+        send();
+        return !waits;
+    }
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <cstdint>
+
+#include "snapshot.h"
+
+// Reference to a pooled object; goes stale (and is detected as such) once the object is despawned
+struct PoolHandle
+{
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const PoolHandle &other) const = default;
+};
+
+/*
+ * Fixed-capacity pool for short-lived objects such as bullets and hit effects.
+ * Everything is allocated up front; spawn and despawn are O(1) through a free list of slots,
+ * and live objects are kept densely packed (despawn moves the last one into the hole)
+ * so update and draw passes walk a contiguous array.
+ */
+template <typename T>
+class ObjectPool
+{
+    struct Slot
+    {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    std::vector<T> items;           // the first 'count' are live
+    std::vector<uint32_t> owners;   // slot of each dense index
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots; // used as a stack, never grows past capacity
+    size_t count = 0;
+
+public:
+    ObjectPool(size_t capacity) : items(capacity), owners(capacity), slots(capacity)
+    {
+        freeSlots.reserve(capacity);
+        for (size_t i = capacity; i-- > 0;)
+        {
+            slots[i] = {0, 0};
+            freeSlots.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return items.size(); }
+    bool isFull() const { return freeSlots.empty(); }
+
+    // Dense access, valid for indices below size()
+    T &operator[](size_t index) { return items[index]; }
+    const T &operator[](size_t index) const { return items[index]; }
+    T *begin() { return items.data(); }
+    T *end() { return items.data() + count; }
+    const T *begin() const { return items.data(); }
+    const T *end() const { return items.data() + count; }
+
+    // Takes a slot and sets the object to 'value'; an invalid handle when the pool is full
+    PoolHandle spawn(const T &value)
+    {
+        if (freeSlots.empty())
+        {
+            return PoolHandle();
+        }
+        const uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+
+        slots[slot].dense = static_cast<uint32_t>(count);
+        owners[count] = slot;
+        items[count] = value;
+        count++;
+        return PoolHandle{slot, slots[slot].generation};
+    }
+
+    bool isValid(PoolHandle h) const
+    {
+        return h.slot < slots.size() && slots[h.slot].generation == h.generation &&
+               slots[h.slot].dense < count && owners[slots[h.slot].dense] == h.slot;
+    }
+
+    // Null when the handle is stale
+    T *get(PoolHandle h) { return isValid(h) ? &items[slots[h.slot].dense] : nullptr; }
+
+    PoolHandle handleOf(size_t index) const
+    {
+        return PoolHandle{owners[index], slots[owners[index]].generation};
+    }
+
+    // Removes the object at a dense index; the last object takes its place, so iterate backwards when despawning in a loop
+    void despawnAt(size_t index)
+    {
+        const uint32_t slot = owners[index];
+        const size_t last = count - 1;
+        if (index != last)
+        {
+            items[index] = items[last];
+            owners[index] = owners[last];
+            slots[owners[index]].dense = static_cast<uint32_t>(index);
+        }
+        count--;
+
+        slots[slot].generation++; // every outstanding handle to it is now stale
+        freeSlots.push_back(slot);
+    }
+
+    void despawn(PoolHandle h)
+    {
+        if (isValid(h))
+        {
+            despawnAt(slots[h.slot].dense);
+        }
+    }
+
+    // The live objects and the slot table; the capacity stays what it was
+    void save(Snapshot &out) const
+    {
+        out.write(static_cast<uint32_t>(count));
+        out.writeRaw(items.data(), count);
+        out.writeRaw(owners.data(), count);
+        out.write(slots);
+        out.write(freeSlots);
+    }
+
+    void load(Snapshot &in)
+    {
+        uint32_t saved;
+        in.read(saved);
+        count = saved;
+        in.readRaw(items.data(), count);
+        in.readRaw(owners.data(), count);
+        in.read(slots);
+        in.read(freeSlots);
+    }
+
+    void clear()
+    {
+        while (count > 0)
+        {
+            despawnAt(count - 1);
+        }
+    }
+};
@@ -0,0 +1,346 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <numeric>
+#include <cmath>
+
+#include "atlasRegion.h"
+
+// One background image as read from the layer file
+struct ParallaxLayer
+{
+    std::string image; // asset name
+    float factor = 0;  // how far it scrolls per pixel the camera moves, 0 stays put
+    float y = 0;
+    bool stretch = false; // fills the whole view instead of repeating sideways
+    AtlasRegion region;   // set by resolve()
+};
+
+/*
+ * Draws the background layers behind the level, read from a text file with one layer per line,
+ * back to front:
+ *   layer <image> <scroll factor> <y> <tile|stretch>
+ * Scrolling follows the camera (the map view port), not the player's speed.
+ *
+ * Neighbouring layers with the same factor always sit still relative to each other, so they are
+ * pre-composited once into one strip texture, one repeat of the layers wider than the view. A strip
+ * that moved by at least a texel this frame is drawn straight from its texture. Runs of neighbouring
+ * strips that sat still are composited into a view sized texture of the run's own, redone only once
+ * one of them has moved, so a still camera draws the whole background as a single quad and a moving
+ * one draws a quad per scrolling strip and one for each run of strips that stay put.
+ */
+class ParallaxCompositor
+{
+    static const int MAX_STRIP_PERIOD = 4096; // layers whose widths repeat together only after more go to separate strips
+
+    struct Strip
+    {
+        size_t firstLayer = 0, layerCount = 0;
+        float factor = 0;
+        int period = 0; // width after which the strip repeats, 0 when it does not scroll
+        SDL_Texture *texture = nullptr;
+        float offset = -1;  // source x drawn last, in whole texels
+        bool moved = false; // this frame
+
+        // the run of still strips starting with this one, composited; created when first needed
+        SDL_Texture *run = nullptr;
+        size_t runLength = 0; // strips 'run' holds, 0 when it is out of date
+    };
+
+    std::vector<ParallaxLayer> layers;
+    std::vector<Strip> strips;
+    int width = 0, height = 0; // view size the textures were built for
+    int recomposes = 0;
+
+    static bool fail(const std::string &path, int line, const char *message)
+    {
+        std::cout << path << ":" << line << ": " << message << std::endl;
+        return false;
+    }
+
+    static SDL_Texture *createTarget(SDL_Renderer *renderer, int w, int h)
+    {
+        SDL_Texture *tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+        if (!tex)
+        {
+            SDL_Log("Could not create parallax texture: %s", SDL_GetError());
+            return nullptr;
+        }
+        SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderTarget(renderer, tex);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        return tex;
+    }
+
+    // Groups neighbouring layers of the same factor, once their image sizes are known
+    void buildStrips()
+    {
+        strips.clear();
+        for (size_t i = 0; i < layers.size(); i++)
+        {
+            const ParallaxLayer &layer = layers[i];
+            const int layerWidth = layer.stretch ? 0 : static_cast<int>(layer.region.rect.w);
+            if (!layer.region.texture.isValid() || (!layer.stretch && layerWidth <= 0))
+            {
+                continue;
+            }
+            const int period = layer.factor == 0 ? 0 : layerWidth;
+            if (!strips.empty() && strips.back().factor == layer.factor &&
+                strips.back().firstLayer + strips.back().layerCount == i)
+            {
+                Strip &strip = strips.back();
+                const int combined = period == 0 ? strip.period : strip.period == 0 ? period : std::lcm(strip.period, period);
+                if (combined <= MAX_STRIP_PERIOD)
+                {
+                    strip.period = combined;
+                    strip.layerCount++;
+                    continue;
+                }
+            }
+            Strip strip;
+            strip.firstLayer = i;
+            strip.layerCount = 1;
+            strip.factor = layer.factor;
+            strip.period = period;
+            strips.push_back(strip);
+        }
+    }
+
+    bool buildTextures(SDL_Renderer *renderer, TextureCache &textures, int viewWidth, int viewHeight)
+    {
+        width = viewWidth;
+        height = viewHeight;
+        SDL_Texture *previousTarget = SDL_GetRenderTarget(renderer);
+        for (Strip &strip : strips)
+        {
+            // one period plus the view, so any offset inside the period is a plain source rect
+            const float stripWidth = static_cast<float>(strip.period + width);
+            strip.texture = createTarget(renderer, static_cast<int>(stripWidth), height);
+            if (!strip.texture)
+            {
+                break;
+            }
+            for (size_t i = strip.firstLayer; i < strip.firstLayer + strip.layerCount; i++)
+            {
+                const ParallaxLayer &layer = layers[i];
+                SDL_Texture *image = textures.get(renderer, layer.region.texture);
+                if (layer.stretch)
+                {
+                    SDL_FRect dst{0, 0, stripWidth, static_cast<float>(height)};
+                    SDL_RenderTexture(renderer, image, &layer.region.rect, &dst);
+                }
+                else
+                {
+                    SDL_FRect dst{0, layer.y, stripWidth, layer.region.rect.h};
+                    SDL_RenderTextureTiled(renderer, image, &layer.region.rect, 1, &dst);
+                }
+            }
+            strip.offset = -1;
+        }
+        SDL_SetRenderTarget(renderer, previousTarget);
+
+        const bool built = strips.empty() || strips.back().texture;
+        if (!built)
+        {
+            releaseAll();
+        }
+        return built;
+    }
+
+    void drawStrip(SDL_Renderer *renderer, const Strip &strip) const
+    {
+        SDL_FRect src{strip.offset, 0, static_cast<float>(width), static_cast<float>(height)};
+        SDL_RenderTexture(renderer, strip.texture, &src, nullptr);
+    }
+
+    // Makes sure the run texture of strip 'first' holds the strips up to 'end'; false if it cannot be created
+    bool compositeRun(SDL_Renderer *renderer, size_t first, size_t end)
+    {
+        Strip &owner = strips[first];
+        if (owner.run && owner.runLength == end - first)
+        {
+            return true;
+        }
+        SDL_Texture *previousTarget = SDL_GetRenderTarget(renderer);
+        if (!owner.run)
+        {
+            owner.run = createTarget(renderer, width, height);
+            if (!owner.run)
+            {
+                SDL_SetRenderTarget(renderer, previousTarget);
+                return false;
+            }
+        }
+        SDL_SetRenderTarget(renderer, owner.run);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        for (size_t s = first; s < end; s++)
+        {
+            drawStrip(renderer, strips[s]);
+        }
+        SDL_SetRenderTarget(renderer, previousTarget);
+        owner.runLength = end - first;
+        recomposes++;
+        return true;
+    }
+
+public:
+    ParallaxCompositor() = default;
+    ~ParallaxCompositor() { releaseAll(); }
+
+    ParallaxCompositor(const ParallaxCompositor &) = delete;
+    ParallaxCompositor &operator=(const ParallaxCompositor &) = delete;
+
+    bool load(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            return fail(path, 0, "could not read the file");
+        }
+        releaseAll();
+        layers.clear();
+        strips.clear();
+
+        std::string text;
+        for (int line = 1; std::getline(in, text); line++)
+        {
+            std::istringstream fields(text.substr(0, text.find('#')));
+            std::string command;
+            if (!(fields >> command))
+            {
+                continue;
+            }
+            ParallaxLayer layer;
+            std::string mode;
+            if (command != "layer" || !(fields >> layer.image >> layer.factor >> layer.y >> mode) ||
+                (mode != "tile" && mode != "stretch"))
+            {
+                return fail(path, line, "expected layer <image> <scroll factor> <y> <tile|stretch>");
+            }
+            layer.stretch = mode == "stretch";
+            if (layer.stretch && layer.factor != 0)
+            {
+                return fail(path, line, "stretched layers cannot scroll");
+            }
+            layers.push_back(layer);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Looks up the layer images once they are loaded and works out which layers share a strip.
+     * @param findImage Returns the AtlasRegion of an image by its asset name; layers with a missing image are left out.
+     */
+    template <typename Fn>
+    void resolve(Fn &&findImage)
+    {
+        releaseAll();
+        for (ParallaxLayer &layer : layers)
+        {
+            layer.region = findImage(layer.image);
+        }
+        buildStrips();
+    }
+
+    size_t getLayerCount() const { return layers.size(); }
+    size_t getStripCount() const { return strips.size(); }
+    // Times a run of still strips had to be composited again, since the textures were built
+    int getRecomposes() const { return recomposes; }
+
+    // Draws the background for the camera at viewPort, covering the whole view; the layer images are only
+    // needed from the cache while the strips are built
+    void draw(SDL_Renderer *renderer, TextureCache &textures, const SDL_FRect &viewPort)
+    {
+        if (strips.empty())
+        {
+            return;
+        }
+        const int viewWidth = static_cast<int>(viewPort.w), viewHeight = static_cast<int>(viewPort.h);
+        if (!strips.front().texture || width != viewWidth || height != viewHeight)
+        {
+            releaseAll();
+            if (!buildTextures(renderer, textures, viewWidth, viewHeight))
+            {
+                return;
+            }
+        }
+
+        for (size_t s = 0; s < strips.size(); s++)
+        {
+            Strip &strip = strips[s];
+            float offset = 0;
+            if (strip.period > 0)
+            {
+                offset = std::floor(std::fmod(viewPort.x * strip.factor, static_cast<float>(strip.period)));
+                if (offset < 0)
+                {
+                    offset += strip.period;
+                }
+            }
+            strip.moved = offset != strip.offset;
+            if (strip.moved)
+            {
+                strip.offset = offset;
+                // every composited run it is part of is out of date
+                for (size_t first = 0; first <= s; first++)
+                {
+                    if (first + strips[first].runLength > s)
+                    {
+                        strips[first].runLength = 0;
+                    }
+                }
+            }
+        }
+
+        // back to front: moved strips on their own, runs of still ones from their composite
+        for (size_t s = 0; s < strips.size();)
+        {
+            size_t end = s + 1;
+            while (!strips[s].moved && end < strips.size() && !strips[end].moved)
+            {
+                end++;
+            }
+            if (end - s > 1 && compositeRun(renderer, s, end))
+            {
+                SDL_RenderTexture(renderer, strips[s].run, nullptr, nullptr);
+            }
+            else
+            {
+                for (size_t i = s; i < end; i++)
+                {
+                    drawStrip(renderer, strips[i]);
+                }
+            }
+            s = end;
+        }
+    }
+
+    // Drops every texture; must be called before the renderer is destroyed and after it reports
+    // that render target contents were lost. They are built again on the next draw.
+    void releaseAll()
+    {
+        for (Strip &strip : strips)
+        {
+            if (strip.texture)
+            {
+                SDL_DestroyTexture(strip.texture);
+                strip.texture = nullptr;
+            }
+            if (strip.run)
+            {
+                SDL_DestroyTexture(strip.run);
+                strip.run = nullptr;
+            }
+            strip.runLength = 0;
+            strip.offset = -1;
+        }
+        recomposes = 0;
+    }
+};
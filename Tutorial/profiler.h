@@ -0,0 +1,305 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <cstdint>
+
+#include "allocTracker.h"
+
+// Profiling is on in debug builds; 'make release' defines NDEBUG, which compiles all of it out.
+// Defining PROFILER_ENABLED on the command line overrides this, as 'make bench' does.
+#ifndef PROFILER_ENABLED
+#ifndef NDEBUG
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+#endif
+
+// Parts of a frame that are timed separately
+enum class ProfilePhase : uint8_t
+{
+    events,
+    update,
+    enemies,
+    integrate,
+    broadphase,
+    narrowphase,
+    resolve,
+    animation,
+    projectiles,
+    rollback, // the ticks simulated again, the phases above count them as well
+    drawBackground,
+    drawTiles,
+    drawObjects,
+    flush,
+    present,
+    count
+};
+
+const size_t PROFILE_PHASE_COUNT = static_cast<size_t>(ProfilePhase::count);
+
+const char *const PROFILE_PHASE_NAMES[PROFILE_PHASE_COUNT] = {
+    "events", "update", "enemies", "integrate", "broadphase", "narrowphase", "resolve", "animation", "projectiles",
+    "rollback", "draw background", "draw tiles", "draw objects", "flush", "present"};
+
+#if PROFILER_ENABLED
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+
+/*
+ * Keeps the last FRAME_CAPACITY frames in a ring buffer: their length, the time spent in every phase
+ * and the individual phase spans for trace export. Nothing allocates once it is constructed,
+ * so it can stay on all the time in debug builds.
+ */
+class Profiler
+{
+public:
+    static const size_t FRAME_CAPACITY = 2048;
+    static const size_t SPANS_PER_FRAME = 32; // phases run several times when the simulation catches up
+
+private:
+    struct Span
+    {
+        ProfilePhase phase;
+        uint32_t begin;    // ticks since the start of the frame
+        uint32_t duration; // ticks
+    };
+
+    struct Frame
+    {
+        uint64_t start = 0;
+        uint64_t length = 0;
+        std::array<uint64_t, PROFILE_PHASE_COUNT> phaseTicks{};
+        std::array<uint32_t, PROFILE_PHASE_COUNT> phaseAllocs{}; // heap allocations, when built with ALLOC_TRACKING
+        std::array<Span, SPANS_PER_FRAME> spans;
+        uint32_t spanCount = 0;
+    };
+
+    std::vector<Frame> frames; // ring buffer
+    size_t next = 0;           // slot of the frame being recorded
+    size_t recorded = 0;       // completed frames, at most FRAME_CAPACITY
+    uint64_t frequency;
+
+    std::vector<uint64_t> sorted;   // scratch for the percentiles
+    std::vector<SDL_FRect> bars;    // scratch for the graph
+
+    const Frame &completed(size_t age) const
+    {
+        // age 0 is the newest completed frame
+        return frames[(next + FRAME_CAPACITY - 1 - age) % FRAME_CAPACITY];
+    }
+
+    double toMs(uint64_t ticks) const { return ticks * 1000.0 / frequency; }
+
+public:
+    Profiler() : frames(FRAME_CAPACITY), frequency(SDL_GetPerformanceFrequency())
+    {
+        sorted.reserve(FRAME_CAPACITY);
+        frames[next].start = SDL_GetPerformanceCounter();
+    }
+
+    // One profiler per thread, so a simulation stage on its own thread records its frames separately
+    static Profiler &get()
+    {
+        static thread_local Profiler instance;
+        return instance;
+    }
+
+    // Closes the current frame and starts the next one
+    void endFrame()
+    {
+        const uint64_t now = SDL_GetPerformanceCounter();
+        frames[next].length = now - frames[next].start;
+        next = (next + 1) % FRAME_CAPACITY;
+        recorded = std::min(recorded + 1, FRAME_CAPACITY);
+
+        Frame &frame = frames[next];
+        frame.start = now;
+        frame.phaseTicks.fill(0);
+        frame.phaseAllocs.fill(0);
+        frame.spanCount = 0;
+    }
+
+    void record(ProfilePhase phase, uint64_t begin, uint64_t end, uint64_t allocations = 0)
+    {
+        Frame &frame = frames[next];
+        frame.phaseTicks[static_cast<size_t>(phase)] += end - begin;
+        frame.phaseAllocs[static_cast<size_t>(phase)] += static_cast<uint32_t>(allocations);
+        if (frame.spanCount < SPANS_PER_FRAME)
+        {
+            frame.spans[frame.spanCount++] = {phase, static_cast<uint32_t>(begin - frame.start), static_cast<uint32_t>(end - begin)};
+        }
+    }
+
+    size_t getFrameCount() const { return recorded; }
+
+    // Length of the newest completed frame and of one of its phases
+    double getLastFrameMs() const { return recorded ? toMs(completed(0).length) : 0; }
+    double getLastPhaseMs(ProfilePhase phase) const
+    {
+        return recorded ? toMs(completed(0).phaseTicks[static_cast<size_t>(phase)]) : 0;
+    }
+
+    // Heap allocations the newest completed frame made in a phase, on this thread; always 0 without ALLOC_TRACKING
+    uint32_t getLastPhaseAllocs(ProfilePhase phase) const
+    {
+        return recorded ? completed(0).phaseAllocs[static_cast<size_t>(phase)] : 0;
+    }
+
+    double getAverageMs(ProfilePhase phase) const
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < recorded; i++)
+        {
+            total += completed(i).phaseTicks[static_cast<size_t>(phase)];
+        }
+        return recorded ? toMs(total) / recorded : 0;
+    }
+
+    double getAverageFrameMs() const
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < recorded; i++)
+        {
+            total += completed(i).length;
+        }
+        return recorded ? toMs(total) / recorded : 0;
+    }
+
+    // Frame time that only 'fraction' of the recorded frames exceed, e.g. 0.01 for the 1% low
+    double getLowMs(double fraction)
+    {
+        if (!recorded)
+        {
+            return 0;
+        }
+        sorted.clear();
+        for (size_t i = 0; i < recorded; i++)
+        {
+            sorted.push_back(completed(i).length);
+        }
+        const size_t rank = std::min(static_cast<size_t>(recorded * (1.0 - fraction)), recorded - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return toMs(sorted[rank]);
+    }
+
+    /**
+     * @brief Draws the frame time graph of the most recent frames with the phase averages and lows next to it.
+     * @param renderer The renderer to draw with, in logical coordinates.
+     * @param area Where the graph goes. One column per frame, the full height is two 60 Hz frames.
+     */
+    void drawOverlay(SDL_Renderer *renderer, const SDL_FRect &area)
+    {
+        const double scale = area.h / 33.3;
+        const size_t shown = std::min(recorded, static_cast<size_t>(area.w));
+        bars.clear();
+        for (size_t i = 0; i < shown; i++)
+        {
+            const float h = static_cast<float>(std::min(toMs(completed(i).length) * scale, static_cast<double>(area.h)));
+            bars.push_back({area.x + area.w - 1 - i, area.y + area.h - h, 1, h});
+        }
+
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+        SDL_RenderFillRect(renderer, &area);
+        SDL_SetRenderDrawColor(renderer, 0, 200, 255, 255);
+        SDL_RenderFillRects(renderer, bars.data(), static_cast<int>(bars.size()));
+        SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+        const float budget = area.y + area.h - static_cast<float>(16.7 * scale);
+        SDL_RenderLine(renderer, area.x, budget, area.x + area.w, budget);
+
+        char line[64];
+        float y = area.y;
+        const float x = area.x + area.w + 4;
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        SDL_snprintf(line, sizeof(line), "frame %.2f ms", getAverageFrameMs());
+        SDL_RenderDebugText(renderer, x, y, line);
+        SDL_snprintf(line, sizeof(line), "1%% %.2f 0.1%% %.2f", getLowMs(0.01), getLowMs(0.001));
+        SDL_RenderDebugText(renderer, x, y += 10, line);
+        for (size_t p = 0; p < PROFILE_PHASE_COUNT; p++)
+        {
+            SDL_snprintf(line, sizeof(line), "%-15s %.3f", PROFILE_PHASE_NAMES[p], getAverageMs(static_cast<ProfilePhase>(p)));
+            SDL_RenderDebugText(renderer, x, y += 10, line);
+        }
+    }
+
+    // One row per frame, oldest first: frame time and then the time of every phase, in milliseconds
+    bool writeCsv(const char *path) const
+    {
+        std::ofstream out(path);
+        out << "frame,total";
+        for (const char *name : PROFILE_PHASE_NAMES)
+        {
+            out << ',' << name;
+        }
+        out << '\n';
+        for (size_t i = recorded; i-- > 0;)
+        {
+            const Frame &frame = completed(i);
+            out << recorded - 1 - i << ',' << toMs(frame.length);
+            for (uint64_t ticks : frame.phaseTicks)
+            {
+                out << ',' << toMs(ticks);
+            }
+            out << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+
+    // Chrome trace event format, open it in chrome://tracing or Perfetto
+    bool writeChromeTrace(const char *path) const
+    {
+        std::ofstream out(path);
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        const auto event = [&](const char *name, uint64_t start, uint64_t length)
+        {
+            out << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+                << toMs(start) * 1000.0 << ",\"dur\":" << toMs(length) * 1000.0 << '}';
+            first = false;
+        };
+        for (size_t i = recorded; i-- > 0;)
+        {
+            const Frame &frame = completed(i);
+            event("frame", frame.start, frame.length);
+            for (uint32_t s = 0; s < frame.spanCount; s++)
+            {
+                const Span &span = frame.spans[s];
+                event(PROFILE_PHASE_NAMES[static_cast<size_t>(span.phase)], frame.start + span.begin, span.duration);
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+};
+
+// Times the enclosing scope as one span of 'phase', and counts the heap allocations it makes on this thread
+class ScopedTimer
+{
+    ProfilePhase phase;
+    uint64_t begin;
+    uint64_t allocations;
+
+public:
+    ScopedTimer(ProfilePhase phase)
+        : phase(phase), begin(SDL_GetPerformanceCounter()), allocations(ALLOC_COUNTS_THREAD().allocations) {}
+    ~ScopedTimer()
+    {
+        Profiler::get().record(phase, begin, SDL_GetPerformanceCounter(), ALLOC_COUNTS_THREAD().allocations - allocations);
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#define PROFILE_END_FRAME() Profiler::get().endFrame()
+
+#else
+
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <cstdint>
+
+#include "tileMap.h"
+#include "textureCache.h"
+
+enum class RenderCommandType : uint8_t
+{
+    background, // the parallax layers for the view port in dst
+    tiles,      // a tile layer for the view port in dst
+    sprite      // one quad of a texture
+};
+
+// One draw of a frame; plain data, so a frame can be recorded on one thread and drawn on another
+struct RenderCommand
+{
+    RenderCommandType type;
+    TileLayer tileLayer;
+    SDL_FlipMode flip;
+    int batchLayer;
+    TextureHandle texture; // resolved when the frame is drawn, so textures can be evicted and reloaded in between
+    SDL_FRect src, dst;
+};
+
+/*
+ * The draws of one frame in the order they were made. The draw passes only append to it and never
+ * call the renderer, whatever needs the renderer (building tile chunks, compositing the background,
+ * batching sprites) happens when the buffer is played back. The storage is kept between frames,
+ * so recording does not allocate once a buffer has seen its largest frame.
+ */
+class RenderCommandBuffer
+{
+    std::vector<RenderCommand> commands;
+
+public:
+    void clear() { commands.clear(); }
+
+    const RenderCommand *begin() const { return commands.data(); }
+    const RenderCommand *end() const { return commands.data() + commands.size(); }
+    size_t size() const { return commands.size(); }
+
+    void background(const SDL_FRect &viewPort)
+    {
+        commands.push_back({RenderCommandType::background, TileLayer::background, SDL_FLIP_NONE, 0, {}, {}, viewPort});
+    }
+
+    void tiles(TileLayer layer, int batchLayer, const SDL_FRect &viewPort)
+    {
+        commands.push_back({RenderCommandType::tiles, layer, SDL_FLIP_NONE, batchLayer, {}, {}, viewPort});
+    }
+
+    // A quad on a sprite batch layer; src is in texels
+    void sprite(TextureHandle texture, const SDL_FRect &src, const SDL_FRect &dst, SDL_FlipMode flip, int batchLayer)
+    {
+        if (texture.isValid())
+        {
+            commands.push_back({RenderCommandType::sprite, TileLayer::background, flip, batchLayer, texture, src, dst});
+        }
+    }
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <vector>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * The simulation state at the start of a tick, as one flat byte image. Each part of the state writes
+ * plain copies of its fields and arrays, and reads them back in the same order; only trivially
+ * copyable types go in, so taking and restoring a snapshot is a handful of memcpys. The buffer is
+ * kept when the snapshot is taken again, so once it has held the largest state nothing allocates.
+ * Two snapshots of the same state are the same bytes, which is what hash() and sameState() check;
+ * that holds as long as the types written have no implicit padding.
+ */
+class Snapshot
+{
+    std::vector<std::byte> bytes;
+    size_t cursor = 0; // read position
+
+public:
+    uint32_t tick = 0;
+    uint64_t checksum = 0; // of the state it holds
+    bool taken = false;
+
+    // Starts over for the state at the start of 'tick'
+    void begin(uint32_t newTick)
+    {
+        bytes.clear();
+        tick = newTick;
+        checksum = 0;
+        taken = true;
+    }
+
+    // Starts reading from the beginning
+    void rewind() { cursor = 0; }
+
+    size_t size() const { return bytes.size(); }
+
+    // FNV-1a over 8 byte words, so the same on every little endian machine
+    uint64_t hash() const
+    {
+        uint64_t result = 14695981039346656037ull;
+        size_t at = 0;
+        for (; at + sizeof(uint64_t) <= bytes.size(); at += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes.data() + at, sizeof(word));
+            result = (result ^ word) * 1099511628211ull;
+        }
+        for (; at < bytes.size(); at++)
+        {
+            result = (result ^ static_cast<uint64_t>(bytes[at])) * 1099511628211ull;
+        }
+        return result;
+    }
+
+    bool sameState(const Snapshot &other) const { return bytes == other.bytes; }
+
+    template <typename T>
+    void writeRaw(const T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "a snapshot only holds plain data");
+        const size_t at = bytes.size();
+        bytes.resize(at + count * sizeof(T));
+        if (count > 0)
+        {
+            std::memcpy(bytes.data() + at, values, count * sizeof(T));
+        }
+    }
+
+    template <typename T>
+    void readRaw(T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "a snapshot only holds plain data");
+        if (count > 0)
+        {
+            std::memcpy(values, bytes.data() + cursor, count * sizeof(T));
+        }
+        cursor += count * sizeof(T);
+    }
+
+    template <typename T>
+    void write(const T &value) { writeRaw(&value, 1); }
+
+    template <typename T>
+    void read(T &value) { readRaw(&value, 1); }
+
+    // A whole vector, its length first
+    template <typename T>
+    void write(const std::vector<T> &values)
+    {
+        write(static_cast<uint32_t>(values.size()));
+        writeRaw(values.data(), values.size());
+    }
+
+    // Resizes the vector to the length written, which does not allocate when it is as long as it was then
+    template <typename T>
+    void read(std::vector<T> &values)
+    {
+        uint32_t count;
+        read(count);
+        values.resize(count);
+        readRaw(values.data(), count);
+    }
+};
+
+// The snapshots of the last 'capacity' ticks, each one in the slot of its tick
+class SnapshotRing
+{
+    std::vector<Snapshot> snapshots;
+
+public:
+    explicit SnapshotRing(size_t capacity) : snapshots(capacity) {}
+
+    size_t capacity() const { return snapshots.size(); }
+
+    // The slot for 'tick', to take its snapshot in; overwrites the one capacity ticks older
+    Snapshot &at(uint32_t tick) { return snapshots[tick % snapshots.size()]; }
+
+    // The snapshot of 'tick', null when it was never taken or has been overwritten since
+    Snapshot *find(uint32_t tick)
+    {
+        Snapshot &snapshot = at(tick);
+        return snapshot.taken && snapshot.tick == tick ? &snapshot : nullptr;
+    }
+
+    void clear()
+    {
+        for (Snapshot &snapshot : snapshots)
+        {
+            snapshot.taken = false;
+        }
+    }
+};
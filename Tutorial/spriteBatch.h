@@ -0,0 +1,122 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+#include <cstdint>
+
+// Counters for the last flush
+struct SpriteBatchStats
+{
+    int sprites = 0;
+    int batches = 0; // SDL_RenderGeometry calls
+};
+
+/*
+ * Collects textured quads for a frame and submits them with as few SDL_RenderGeometry calls as possible.
+ * Quads are sorted by layer and keep their submission order inside a layer, so overlapping sprites
+ * always stack the same way; every run of consecutive quads sharing a texture goes out as one
+ * vertex/index submission.
+ * Flips are done by swapping texture coordinates, so they never break a run.
+ * The vertices and indices only live for one flush and come from the caller's frame scratch memory.
+ */
+class SpriteBatch
+{
+    struct Quad
+    {
+        SDL_Texture *texture;
+        int layer;
+        uint32_t order;
+        SDL_FRect src; // in texels
+        SDL_FRect dst;
+        SDL_FlipMode flip;
+    };
+
+    std::vector<Quad> quads;
+    SpriteBatchStats stats;
+
+    void submit(SDL_Renderer *renderer, SDL_Texture *texture, std::pmr::vector<SDL_Vertex> &vertices, std::pmr::vector<int> &indices)
+    {
+        if (!indices.empty())
+        {
+            SDL_RenderGeometry(renderer, texture, vertices.data(), static_cast<int>(vertices.size()),
+                               indices.data(), static_cast<int>(indices.size()));
+            stats.batches++;
+        }
+        vertices.clear();
+        indices.clear();
+    }
+
+public:
+    const SpriteBatchStats &getStats() const { return stats; }
+
+    // Queues a quad. A null src means the whole texture; lower layers are drawn first
+    void draw(SDL_Texture *texture, const SDL_FRect *src, const SDL_FRect &dst, SDL_FlipMode flip = SDL_FLIP_NONE, int layer = 0)
+    {
+        if (!texture)
+        {
+            return;
+        }
+        const SDL_FRect full{0, 0, static_cast<float>(texture->w), static_cast<float>(texture->h)};
+        quads.push_back({texture, layer, static_cast<uint32_t>(quads.size()), src ? *src : full, dst, flip});
+    }
+
+    /**
+     * @brief Draws everything queued since the last flush.
+     * @param renderer The renderer to draw with.
+     * @param scratch Where the vertices and indices are built, e.g. a FrameArena; sized for the whole frame up front.
+     */
+    void flush(SDL_Renderer *renderer, std::pmr::memory_resource *scratch)
+    {
+        stats = SpriteBatchStats();
+        stats.sprites = static_cast<int>(quads.size());
+
+        // never by texture: its address changes between runs, and so would the stacking of overlapping quads
+        std::sort(quads.begin(), quads.end(), [](const Quad &a, const Quad &b)
+                  {
+            if (a.layer != b.layer)
+                return a.layer < b.layer;
+            return a.order < b.order; });
+
+        // a run can hold every quad at most, so neither vector grows while it is filled
+        std::pmr::vector<SDL_Vertex> vertices(scratch);
+        std::pmr::vector<int> indices(scratch);
+        vertices.reserve(quads.size() * 4);
+        indices.reserve(quads.size() * 6);
+
+        const SDL_FColor white{1, 1, 1, 1};
+        SDL_Texture *current = nullptr;
+        for (const Quad &q : quads)
+        {
+            if (q.texture != current)
+            {
+                submit(renderer, current, vertices, indices);
+                current = q.texture;
+            }
+
+            float u0 = q.src.x / q.texture->w;
+            float v0 = q.src.y / q.texture->h;
+            float u1 = (q.src.x + q.src.w) / q.texture->w;
+            float v1 = (q.src.y + q.src.h) / q.texture->h;
+            if (q.flip & SDL_FLIP_HORIZONTAL)
+                std::swap(u0, u1);
+            if (q.flip & SDL_FLIP_VERTICAL)
+                std::swap(v0, v1);
+
+            const int base = static_cast<int>(vertices.size());
+            const float x0 = q.dst.x, y0 = q.dst.y, x1 = q.dst.x + q.dst.w, y1 = q.dst.y + q.dst.h;
+            vertices.push_back({{x0, y0}, white, {u0, v0}});
+            vertices.push_back({{x1, y0}, white, {u1, v0}});
+            vertices.push_back({{x1, y1}, white, {u1, v1}});
+            vertices.push_back({{x0, y1}, white, {u0, v1}});
+
+            const int quadIndices[6] = {0, 1, 2, 0, 2, 3};
+            for (int i : quadIndices)
+            {
+                indices.push_back(base + i);
+            }
+        }
+        submit(renderer, current, vertices, indices);
+        quads.clear();
+    }
+};
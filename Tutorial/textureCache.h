@@ -0,0 +1,254 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+// Reference to a texture in a TextureCache; goes stale (and resolves to null) once its last reference is released
+struct TextureHandle
+{
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isValid() const { return slot != UINT32_MAX; }
+    bool operator==(const TextureHandle &other) const = default;
+};
+
+struct TextureCacheStats
+{
+    uint64_t hits = 0;      // get() found the texture resident
+    uint64_t misses = 0;    // get() had to load it first
+    uint64_t evictions = 0;
+    size_t residentBytes = 0;
+    size_t peakBytes = 0;
+    size_t residentCount = 0;
+};
+
+/*
+ * Owns the textures of images and atlas pages and keeps their memory under a budget. Every texture is
+ * registered with a loader that can create it again; get() loads it on demand and marks it used in the
+ * current frame, and endFrame() evicts textures that have not been used for idleFrames frames, least
+ * recently used first, for as long as more than the budget is resident. An evicted texture is loaded
+ * again by the next get() that wants it, so texture memory is bounded by the budget instead of by the
+ * total size of the assets. A frame that draws more than the budget still gets all of it.
+ *
+ * Handles are reference counted: add() hands out the first reference, and the texture and its slot are
+ * freed when the last one is released. Only call it from the thread that owns the renderer.
+ */
+class TextureCache
+{
+public:
+    using Loader = std::function<SDL_Texture *(SDL_Renderer *)>;
+
+private:
+    struct Entry
+    {
+        Loader load;
+        SDL_Texture *texture = nullptr;
+        size_t bytes = 0;
+        uint32_t refs = 0;
+        uint32_t generation = 0;
+        uint64_t lastUsed = 0; // frame
+        bool failed = false;   // not tried again, so a missing file is not reloaded every frame
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> candidates; // scratch for endFrame(), kept so evicting does not allocate
+    size_t budget;
+    uint64_t idleFrames;
+    uint64_t frame = 0;
+    TextureCacheStats stats;
+
+    Entry *find(TextureHandle handle)
+    {
+        return handle.slot < entries.size() && entries[handle.slot].generation == handle.generation &&
+                       entries[handle.slot].refs > 0
+                   ? &entries[handle.slot]
+                   : nullptr;
+    }
+
+    static size_t sizeOf(SDL_Texture *texture) { return static_cast<size_t>(texture->w) * texture->h * 4; }
+
+    void makeResident(Entry &entry, SDL_Texture *texture)
+    {
+        entry.texture = texture;
+        entry.bytes = sizeOf(texture);
+        entry.lastUsed = frame;
+        stats.residentBytes += entry.bytes;
+        stats.residentCount++;
+        stats.peakBytes = std::max(stats.peakBytes, stats.residentBytes);
+    }
+
+    bool load(SDL_Renderer *renderer, Entry &entry)
+    {
+        SDL_Texture *texture = entry.failed ? nullptr : entry.load(renderer);
+        if (!texture)
+        {
+            entry.failed = true;
+            return false;
+        }
+        makeResident(entry, texture);
+        return true;
+    }
+
+    void evict(Entry &entry)
+    {
+        SDL_DestroyTexture(entry.texture);
+        entry.texture = nullptr;
+        stats.residentBytes -= entry.bytes;
+        stats.residentCount--;
+    }
+
+public:
+    /**
+     * @param budgetBytes Texture memory kept resident at most, as far as eviction can get it there.
+     * @param idleFrames Frames a texture has to go unused before it may be evicted.
+     */
+    TextureCache(size_t budgetBytes, uint64_t idleFrames) : budget(budgetBytes), idleFrames(idleFrames) {}
+    ~TextureCache() { clear(); }
+
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    void setBudget(size_t budgetBytes) { budget = budgetBytes; }
+    size_t getBudget() const { return budget; }
+
+    /**
+     * @brief Registers a texture, with one reference to it.
+     * @param load Creates the texture, on the first get() and again after every eviction; returns null on failure.
+     * @param texture The texture if it is already loaded, the cache owns it from here on.
+     * @return The handle.
+     */
+    TextureHandle add(Loader load, SDL_Texture *texture = nullptr)
+    {
+        if (freeSlots.empty())
+        {
+            freeSlots.push_back(static_cast<uint32_t>(entries.size()));
+            entries.emplace_back();
+        }
+        const uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+
+        Entry &entry = entries[slot];
+        entry.load = std::move(load);
+        entry.refs = 1;
+        entry.failed = false;
+        if (texture)
+        {
+            makeResident(entry, texture);
+        }
+        return {slot, entry.generation};
+    }
+
+    void retain(TextureHandle handle)
+    {
+        if (Entry *entry = find(handle))
+        {
+            entry->refs++;
+        }
+    }
+
+    // Drops a reference; the last one destroys the texture and makes every handle to it stale
+    void release(TextureHandle handle)
+    {
+        Entry *entry = find(handle);
+        if (!entry || --entry->refs > 0)
+        {
+            return;
+        }
+        if (entry->texture)
+        {
+            evict(*entry);
+        }
+        entry->load = nullptr;
+        entry->generation++;
+        freeSlots.push_back(handle.slot);
+    }
+
+    // The texture, loaded first if it is not resident; null for a stale handle or a texture that failed to load
+    SDL_Texture *get(SDL_Renderer *renderer, TextureHandle handle)
+    {
+        Entry *entry = find(handle);
+        if (!entry)
+        {
+            return nullptr;
+        }
+        if (entry->texture)
+        {
+            stats.hits++;
+        }
+        else
+        {
+            stats.misses++;
+            if (!load(renderer, *entry))
+            {
+                return nullptr;
+            }
+        }
+        entry->lastUsed = frame;
+        return entry->texture;
+    }
+
+    // Loads a texture ahead of its first use, but only if it fits into the budget
+    void preload(SDL_Renderer *renderer, TextureHandle handle)
+    {
+        Entry *entry = find(handle);
+        if (entry && !entry->texture && stats.residentBytes < budget)
+        {
+            load(renderer, *entry);
+            if (entry->texture && stats.residentBytes > budget)
+            {
+                evict(*entry);
+            }
+        }
+    }
+
+    // Call once per frame after present: evicts idle textures, least recently used first, until under the budget
+    void endFrame()
+    {
+        frame++;
+        if (stats.residentBytes <= budget)
+        {
+            return;
+        }
+        candidates.clear();
+        for (uint32_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].texture && frame - entries[i].lastUsed >= idleFrames)
+            {
+                candidates.push_back(i);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b)
+                  { return entries[a].lastUsed < entries[b].lastUsed; });
+        for (size_t i = 0; i < candidates.size() && stats.residentBytes > budget; i++)
+        {
+            evict(entries[candidates[i]]);
+            stats.evictions++;
+        }
+    }
+
+    // Destroys every texture but keeps the handles; they load again on their next get()
+    void releaseAll()
+    {
+        for (Entry &entry : entries)
+        {
+            if (entry.texture)
+            {
+                evict(entry);
+            }
+        }
+    }
+
+    // Destroys every texture and forgets every handle; must be called before the renderer is destroyed
+    void clear()
+    {
+        releaseAll();
+        entries.clear();
+        freeSlots.clear();
+    }
+
+    const TextureCacheStats &getStats() const { return stats; }
+};
@@ -0,0 +1,213 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <array>
+#include <vector>
+#include <algorithm>
+
+#include "tileMap.h"
+#include "spriteBatch.h"
+#include "textureCache.h"
+
+/*
+ * Pre-renders static tile layers into chunk textures, CHUNK_COLUMNS tiles wide and as tall as the map.
+ * Drawing a layer then costs one quad per chunk that intersects the view port, however long the level is.
+ * Chunks are built the first time they come into view and released again once they are far off screen,
+ * so texture memory stays bounded as well.
+ */
+class TileChunkCache
+{
+public:
+    static const int CHUNK_COLUMNS = 16;
+
+private:
+    enum class ChunkState : uint8_t
+    {
+        unbuilt,
+        empty, // nothing on this layer in the chunk, nothing to draw
+        built,
+        stale // built, but its tiles changed since; rebuilt on its next draw
+    };
+
+    struct LayerChunks
+    {
+        std::vector<ChunkState> states;
+        std::vector<SDL_Texture *> textures;
+        std::vector<int> resident; // chunks that currently own a texture
+    };
+
+    std::array<LayerChunks, TILE_LAYER_COUNT> layers;
+    int keepChunks; // chunks beyond the visible ones on each side that stay resident
+    int drawCalls;
+
+    void build(SDL_Renderer *renderer, TextureCache &textures, const TileMap &map, TileLayer layer, int chunk)
+    {
+        LayerChunks &chunks = layers[static_cast<size_t>(layer)];
+        const int firstColumn = chunk * CHUNK_COLUMNS;
+        const int lastColumn = std::min(firstColumn + CHUNK_COLUMNS, map.getColumns()) - 1;
+
+        bool hasTiles = false;
+        for (int c = firstColumn; c <= lastColumn && !hasTiles; c++)
+        {
+            for (int r = 0; r < map.getRows() && !hasTiles; r++)
+            {
+                hasTiles = map.get(layer, r, c) != 0;
+            }
+        }
+        if (!hasTiles)
+        {
+            chunks.states[chunk] = ChunkState::empty;
+            return;
+        }
+
+        const float tileSize = map.getTileSize();
+        SDL_Texture *tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET,
+                                             static_cast<int>(CHUNK_COLUMNS * tileSize),
+                                             static_cast<int>(map.getRows() * tileSize));
+        if (!tex)
+        {
+            // leave it unbuilt, we try again next frame
+            SDL_Log("Could not create tile chunk texture: %s", SDL_GetError());
+            return;
+        }
+        SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_NEAREST);
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+
+        SDL_Texture *previousTarget = SDL_GetRenderTarget(renderer);
+        SDL_SetRenderTarget(renderer, tex);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        for (int c = firstColumn; c <= lastColumn; c++)
+        {
+            for (int r = 0; r < map.getRows(); r++)
+            {
+                const uint8_t id = map.get(layer, r, c);
+                if (id)
+                {
+                    SDL_FRect dst{
+                        .x = (c - firstColumn) * tileSize,
+                        .y = r * tileSize,
+                        .w = tileSize,
+                        .h = tileSize};
+                    const AtlasRegion &image = map.getProperties(id).image;
+                    SDL_RenderTexture(renderer, textures.get(renderer, image.texture), &image.rect, &dst);
+                }
+            }
+        }
+        SDL_SetRenderTarget(renderer, previousTarget);
+
+        chunks.textures[chunk] = tex;
+        chunks.states[chunk] = ChunkState::built;
+        chunks.resident.push_back(chunk);
+    }
+
+    void release(LayerChunks &chunks, int chunk)
+    {
+        SDL_DestroyTexture(chunks.textures[chunk]);
+        chunks.textures[chunk] = nullptr;
+        chunks.states[chunk] = ChunkState::unbuilt;
+    }
+
+public:
+    TileChunkCache(int keepChunks = 2) : keepChunks(keepChunks), drawCalls(0) {}
+    ~TileChunkCache() { releaseAll(); }
+
+    TileChunkCache(const TileChunkCache &) = delete;
+    TileChunkCache &operator=(const TileChunkCache &) = delete;
+
+    // Number of chunk quads queued since the last resetStats()
+    int getDrawCalls() const { return drawCalls; }
+    void resetStats() { drawCalls = 0; }
+
+    // Builds missing chunks right away, from tile images out of 'textures', and queues the visible ones on 'batch'
+    void draw(SDL_Renderer *renderer, TextureCache &textures, SpriteBatch &batch, int batchLayer, const TileMap &map, TileLayer layer, const SDL_FRect &viewPort)
+    {
+        LayerChunks &chunks = layers[static_cast<size_t>(layer)];
+        const int chunkCount = (map.getColumns() + CHUNK_COLUMNS - 1) / CHUNK_COLUMNS;
+        if (static_cast<int>(chunks.states.size()) != chunkCount)
+        {
+            releaseAll();
+            chunks.states.assign(chunkCount, ChunkState::unbuilt);
+            chunks.textures.assign(chunkCount, nullptr);
+        }
+
+        const float chunkWidth = CHUNK_COLUMNS * map.getTileSize();
+        const SDL_FPoint origin = map.getOrigin();
+        const int first = std::max(static_cast<int>(std::floor((viewPort.x - origin.x) / chunkWidth)), 0);
+        const int last = std::min(static_cast<int>(std::floor((viewPort.x + viewPort.w - origin.x) / chunkWidth)), chunkCount - 1);
+
+        for (int chunk = first; chunk <= last; chunk++)
+        {
+            if (chunks.states[chunk] == ChunkState::stale)
+            {
+                release(chunks, chunk);
+                chunks.resident.erase(std::find(chunks.resident.begin(), chunks.resident.end(), chunk));
+            }
+            if (chunks.states[chunk] == ChunkState::unbuilt)
+            {
+                build(renderer, textures, map, layer, chunk);
+            }
+            if (chunks.states[chunk] == ChunkState::built)
+            {
+                SDL_FRect dst{
+                    .x = origin.x + chunk * chunkWidth - viewPort.x,
+                    .y = origin.y - viewPort.y,
+                    .w = static_cast<float>(chunks.textures[chunk]->w),
+                    .h = static_cast<float>(chunks.textures[chunk]->h)};
+                batch.draw(chunks.textures[chunk], nullptr, dst, SDL_FLIP_NONE, batchLayer);
+                drawCalls++;
+            }
+        }
+
+        // let go of chunks that have scrolled well out of view
+        auto &resident = chunks.resident;
+        for (size_t i = 0; i < resident.size();)
+        {
+            if (resident[i] < first - keepChunks || resident[i] > last + keepChunks)
+            {
+                release(chunks, resident[i]);
+                resident[i] = resident.back();
+                resident.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    // Rebuild chunks covering these columns on their next draw, e.g. after a level chunk was streamed in.
+    // Only marks them, so it may run on another thread than draw() as long as both hold the tile map's lock.
+    void invalidateColumns(int firstColumn, int lastColumn)
+    {
+        for (LayerChunks &chunks : layers)
+        {
+            const int last = std::min(lastColumn / CHUNK_COLUMNS, static_cast<int>(chunks.states.size()) - 1);
+            for (int chunk = std::max(firstColumn / CHUNK_COLUMNS, 0); chunk <= last; chunk++)
+            {
+                if (chunks.states[chunk] == ChunkState::built)
+                {
+                    chunks.states[chunk] = ChunkState::stale;
+                }
+                else if (chunks.states[chunk] == ChunkState::empty)
+                {
+                    chunks.states[chunk] = ChunkState::unbuilt;
+                }
+            }
+        }
+    }
+
+    // Drops every chunk texture; must be called before the renderer is destroyed
+    // and after the renderer reports that render target contents were lost
+    void releaseAll()
+    {
+        for (LayerChunks &chunks : layers)
+        {
+            for (int chunk : chunks.resident)
+            {
+                release(chunks, chunk);
+            }
+            chunks.resident.clear();
+            std::fill(chunks.states.begin(), chunks.states.end(), ChunkState::unbuilt);
+        }
+    }
+};
@@ -0,0 +1,206 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "atlasRegion.h"
+
+enum class TileLayer
+{
+    background,
+    level,
+    foreground
+};
+
+const size_t TILE_LAYER_COUNT = 3;
+
+// Everything shared by all tiles with the same ID
+struct TileProperties
+{
+    AtlasRegion image;
+    bool solid = false;
+};
+
+/*
+ * Tile grid split into chunks of chunkColumns columns. A chunk holds one byte per cell for every layer,
+ * stored column by column, so a horizontal slice of the level is contiguous in memory; the tile
+ * properties are kept in a side table. Chunks live in a fixed number of slots: a level built in memory
+ * gets a slot for every chunk, a streamed level only for the chunks around the view port, and cells of
+ * chunks that are not resident read as empty.
+ */
+class TileMap
+{
+    int rows, columns;
+    float tileSize;
+    SDL_FPoint origin; // world position of the top left corner of cell (0, 0)
+    int chunkColumns;
+    size_t chunkSize;                // bytes per chunk, all layers
+    std::vector<int32_t> chunkSlots; // slot of every chunk, -1 when it is not resident
+    std::vector<uint8_t> slots;      // chunkSize bytes per slot
+    std::vector<int32_t> freeSlots;
+    std::vector<TileProperties> properties; // indexed by tile ID, ID 0 is always empty
+
+    size_t offset(TileLayer layer, int row, int column) const
+    {
+        return static_cast<size_t>(layer) * chunkColumns * rows + static_cast<size_t>(column % chunkColumns) * rows + row;
+    }
+
+public:
+    TileMap() : rows(0), columns(0), tileSize(0), origin{0, 0}, chunkColumns(1), chunkSize(0), properties(1) {}
+
+    /**
+     * @brief Sets the size of the map and drops all cells.
+     * @param residentChunks How many chunks can be resident at once. 0 makes every chunk resident right away, empty.
+     */
+    void resize(int rows, int columns, float tileSize, SDL_FPoint origin, int chunkColumns = 16, int residentChunks = 0)
+    {
+        this->rows = rows;
+        this->columns = columns;
+        this->tileSize = tileSize;
+        this->origin = origin;
+        this->chunkColumns = chunkColumns;
+        chunkSize = TILE_LAYER_COUNT * static_cast<size_t>(chunkColumns) * rows;
+
+        const int chunkCount = getChunkCount();
+        const int slotCount = residentChunks > 0 ? std::min(residentChunks, chunkCount) : chunkCount;
+        chunkSlots.assign(chunkCount, -1);
+        slots.assign(slotCount * chunkSize, 0);
+        freeSlots.clear();
+        for (int slot = slotCount - 1; slot >= 0; slot--)
+        {
+            freeSlots.push_back(slot);
+        }
+        if (residentChunks <= 0)
+        {
+            for (int chunk = 0; chunk < chunkCount; chunk++)
+            {
+                loadChunk(chunk);
+            }
+        }
+    }
+
+    int getRows() const { return rows; }
+    int getColumns() const { return columns; }
+    float getTileSize() const { return tileSize; }
+    SDL_FPoint getOrigin() const { return origin; }
+    int getChunkColumns() const { return chunkColumns; }
+    int getChunkCount() const { return (columns + chunkColumns - 1) / chunkColumns; }
+    size_t getChunkSize() const { return chunkSize; }
+
+    bool isResident(int chunk) const { return chunk >= 0 && chunk < static_cast<int>(chunkSlots.size()) && chunkSlots[chunk] >= 0; }
+
+    // Makes a chunk resident and returns its cells to fill in: per layer, column by column,
+    // 'rows' bytes per column. Null when every slot is taken.
+    uint8_t *loadChunk(int chunk)
+    {
+        if (!isResident(chunk))
+        {
+            if (freeSlots.empty())
+            {
+                return nullptr;
+            }
+            chunkSlots[chunk] = freeSlots.back();
+            freeSlots.pop_back();
+            std::fill_n(&slots[chunkSlots[chunk] * chunkSize], chunkSize, 0);
+        }
+        return &slots[chunkSlots[chunk] * chunkSize];
+    }
+
+    void releaseChunk(int chunk)
+    {
+        if (isResident(chunk))
+        {
+            freeSlots.push_back(chunkSlots[chunk]);
+            chunkSlots[chunk] = -1;
+        }
+    }
+
+    void setProperties(uint8_t id, const TileProperties &props)
+    {
+        if (id >= properties.size())
+        {
+            properties.resize(id + 1);
+        }
+        properties[id] = props;
+    }
+
+    const TileProperties &getProperties(uint8_t id) const
+    {
+        return id < properties.size() ? properties[id] : properties[0];
+    }
+
+    bool inBounds(int row, int column) const
+    {
+        return row >= 0 && row < rows && column >= 0 && column < columns;
+    }
+
+    // Cells outside the map or in chunks that are not resident read as empty
+    uint8_t get(TileLayer layer, int row, int column) const
+    {
+        if (!inBounds(row, column))
+        {
+            return 0;
+        }
+        const int32_t slot = chunkSlots[column / chunkColumns];
+        return slot >= 0 ? slots[slot * chunkSize + offset(layer, row, column)] : 0;
+    }
+
+    // Ignored outside the map and in chunks that are not resident
+    void set(TileLayer layer, int row, int column, uint8_t id)
+    {
+        if (inBounds(row, column))
+        {
+            const int32_t slot = chunkSlots[column / chunkColumns];
+            if (slot >= 0)
+            {
+                slots[slot * chunkSize + offset(layer, row, column)] = id;
+            }
+        }
+    }
+
+    bool isSolid(int row, int column) const
+    {
+        return getProperties(get(TileLayer::level, row, column)).solid;
+    }
+
+    int columnAt(float x) const { return static_cast<int>(std::floor((x - origin.x) / tileSize)); }
+    int rowAt(float y) const { return static_cast<int>(std::floor((y - origin.y) / tileSize)); }
+
+    SDL_FRect cellRect(int row, int column) const
+    {
+        return SDL_FRect{
+            .x = origin.x + column * tileSize,
+            .y = origin.y + row * tileSize,
+            .w = tileSize,
+            .h = tileSize};
+    }
+
+    // Calls fn(row, column, id) for every non-empty cell of 'layer' that 'rect' touches
+    template <typename Fn>
+    void forEachCell(TileLayer layer, const SDL_FRect &rect, Fn &&fn) const
+    {
+        const int firstRow = std::max(rowAt(rect.y), 0);
+        const int lastRow = std::min(rowAt(rect.y + rect.h), rows - 1);
+        const int firstColumn = std::max(columnAt(rect.x), 0);
+        const int lastColumn = std::min(columnAt(rect.x + rect.w), columns - 1);
+
+        for (int c = firstColumn; c <= lastColumn; c++)
+        {
+            const int32_t slot = chunkSlots[c / chunkColumns];
+            if (slot < 0)
+            {
+                continue;
+            }
+            const uint8_t *column = &slots[slot * chunkSize + offset(layer, 0, c)];
+            for (int r = firstRow; r <= lastRow; r++)
+            {
+                if (column[r])
+                {
+                    fn(r, c, column[r]);
+                }
+            }
+        }
+    }
+};
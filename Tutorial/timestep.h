@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+ * Turns variable frame times into a whole number of fixed simulation ticks.
+ * Leftover time is carried over to the next frame and exposed as an interpolation
+ * factor so rendering can blend between the previous and the current tick.
+ */
+class FixedTimestep
+{
+    float tickLength;
+    float accumulator;
+    int maxSteps;
+
+public:
+    // A tick rate of 0 disables fixed stepping: every frame runs one tick of the frame's length
+    FixedTimestep(float tickRate, int maxSteps)
+        : tickLength(tickRate > 0 ? 1.0f / tickRate : 0), accumulator(0), maxSteps(maxSteps) {}
+
+    bool isFixed() const { return tickLength > 0; }
+
+    // Adds the frame's time and returns how many ticks to simulate, never more than maxSteps
+    int advance(float frameTime)
+    {
+        if (!isFixed())
+        {
+            accumulator = frameTime;
+            return 1;
+        }
+
+        accumulator += frameTime;
+        int steps = static_cast<int>(accumulator / tickLength);
+        if (steps > maxSteps)
+        {
+            // after a hitch we drop the time we cannot catch up on instead of spiralling
+            steps = maxSteps;
+            accumulator = steps * tickLength;
+        }
+        accumulator -= steps * tickLength;
+        return steps;
+    }
+
+    // Length of one simulation tick in seconds
+    float getTickLength() const { return isFixed() ? tickLength : accumulator; }
+
+    // How far rendering is between the previous tick (0) and the current one (1)
+    float getAlpha() const { return isFixed() ? accumulator / tickLength : 1.0f; }
+};
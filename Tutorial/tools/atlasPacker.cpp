@@ -0,0 +1,263 @@
+// Packs the game's PNGs into atlas pages and writes them, already decoded, into one asset pack.
+//
+// Usage: atlasPacker <data dir> <output pack> [page size]
+// Every *.png in the data dir and in its tiles/ and bg/ folders is packed. Assets are named by their
+// path below the data dir without extension ("idle", "tiles/brick", ...) and the game looks them up
+// by assetId(name).
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+#include <SDL3_image/SDL_image.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include "../assetPack.h"
+
+struct Image
+{
+    std::string name;
+    SDL_Surface *surface; // RGBA32
+    int page, x, y;
+};
+
+struct Page
+{
+    int width, height;
+    std::vector<uint8_t> pixels;
+};
+
+const int PADDING = 1; // empty texels between images so neighbours never bleed into each other
+
+std::vector<Image> loadImages(const std::string &dataDir);
+std::vector<Page> pack(std::vector<Image> &images, int pageSize);
+bool writePack(const std::string &path, const std::vector<Image> &images, const std::vector<Page> &pages);
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: atlasPacker <data dir> <output pack> [page size]" << std::endl;
+        return 1;
+    }
+    const std::string dataDir = argv[1];
+    const std::string output = argv[2];
+    const int pageSize = argc > 3 ? std::atoi(argv[3]) : 2048;
+
+    if (!SDL_Init(0))
+    {
+        std::cout << "Error Initializing SDL3: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    std::vector<Image> images = loadImages(dataDir);
+    if (images.empty())
+    {
+        std::cout << "No images found in " << dataDir << std::endl;
+        SDL_Quit();
+        return 1;
+    }
+
+    std::vector<Page> pages = pack(images, pageSize);
+    const bool ok = writePack(output, images, pages);
+    if (ok)
+    {
+        std::cout << "Packed " << images.size() << " images into " << pages.size() << " page(s): " << output << std::endl;
+    }
+
+    for (Image &img : images)
+    {
+        SDL_DestroySurface(img.surface);
+    }
+    SDL_Quit();
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief Decodes every PNG the game uses and converts it to RGBA32.
+ * @param dataDir The game's data directory.
+ * @return The decoded images, named by their path below dataDir without extension.
+ */
+std::vector<Image> loadImages(const std::string &dataDir)
+{
+    std::vector<Image> images;
+    for (const std::string folder : {"", "tiles/", "bg/"})
+    {
+        int count = 0;
+        char **files = SDL_GlobDirectory((dataDir + "/" + folder).c_str(), "*.png", 0, &count);
+        for (int i = 0; files && i < count; i++)
+        {
+            const std::string file = files[i];
+            SDL_Surface *loaded = IMG_Load((dataDir + "/" + folder + file).c_str());
+            if (!loaded)
+            {
+                std::cout << "Skipping " << folder << file << ": " << SDL_GetError() << std::endl;
+                continue;
+            }
+            SDL_Surface *rgba = SDL_ConvertSurface(loaded, SDL_PIXELFORMAT_RGBA32);
+            SDL_DestroySurface(loaded);
+
+            const std::string name = folder + file.substr(0, file.rfind('.'));
+            if (!rgba || name.size() >= sizeof(PackEntry::name))
+            {
+                std::cout << "Skipping " << name << std::endl;
+                SDL_DestroySurface(rgba);
+                continue;
+            }
+            images.push_back({name, rgba, -1, 0, 0});
+        }
+        SDL_free(files);
+    }
+    return images;
+}
+
+/**
+ * @brief Shelf packs the images into pages, tallest first, and copies their pixels in.
+ * @param images The images to place; their page and position are filled in.
+ * @param pageSize Width and height of a page. Larger images get a page of their own.
+ * @return The packed pages.
+ */
+std::vector<Page> pack(std::vector<Image> &images, int pageSize)
+{
+    std::vector<Image *> order;
+    for (Image &img : images)
+    {
+        order.push_back(&img);
+    }
+    std::sort(order.begin(), order.end(), [](const Image *a, const Image *b)
+              { return a->surface->h != b->surface->h ? a->surface->h > b->surface->h : a->surface->w > b->surface->w; });
+
+    std::vector<Page> pages;
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (Image *img : order)
+    {
+        const int w = img->surface->w + PADDING;
+        const int h = img->surface->h + PADDING;
+
+        if (w > pageSize || h > pageSize)
+        {
+            pages.push_back({w, h, {}});
+            img->page = static_cast<int>(pages.size()) - 1;
+            img->x = img->y = 0;
+            continue;
+        }
+
+        if (pages.empty() || pages.back().width != pageSize || shelfX + w > pageSize)
+        {
+            // next shelf, or a new page when the shelf would not fit
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+            if (pages.empty() || pages.back().width != pageSize || shelfY + h > pageSize)
+            {
+                pages.push_back({pageSize, pageSize, {}});
+                shelfY = 0;
+            }
+        }
+
+        img->page = static_cast<int>(pages.size()) - 1;
+        img->x = shelfX;
+        img->y = shelfY;
+        shelfX += w;
+        shelfHeight = std::max(shelfHeight, h);
+    }
+
+    // shrink the last shared page to what is actually used, then copy the pixels in
+    for (size_t p = 0; p < pages.size(); p++)
+    {
+        int usedW = 1, usedH = 1;
+        for (const Image &img : images)
+        {
+            if (img.page == static_cast<int>(p))
+            {
+                usedW = std::max(usedW, img.x + img.surface->w);
+                usedH = std::max(usedH, img.y + img.surface->h);
+            }
+        }
+        pages[p].width = usedW;
+        pages[p].height = usedH;
+        pages[p].pixels.assign(static_cast<size_t>(usedW) * usedH * 4, 0);
+    }
+    for (const Image &img : images)
+    {
+        Page &page = pages[img.page];
+        const uint8_t *src = static_cast<const uint8_t *>(img.surface->pixels);
+        for (int row = 0; row < img.surface->h; row++)
+        {
+            std::memcpy(&page.pixels[(static_cast<size_t>(img.y + row) * page.width + img.x) * 4],
+                        src + static_cast<size_t>(row) * img.surface->pitch,
+                        static_cast<size_t>(img.surface->w) * 4);
+        }
+    }
+    return pages;
+}
+
+/**
+ * @brief Writes the header, page table, manifest and page pixels.
+ * @param path Where to write the pack.
+ * @param images The packed images.
+ * @param pages The pages holding them.
+ * @return True on success.
+ */
+bool writePack(const std::string &path, const std::vector<Image> &images, const std::vector<Page> &pages)
+{
+    std::vector<PackEntry> entries;
+    for (const Image &img : images)
+    {
+        PackEntry e{};
+        e.id = assetId(img.name);
+        e.page = static_cast<uint16_t>(img.page);
+        e.x = static_cast<uint16_t>(img.x);
+        e.y = static_cast<uint16_t>(img.y);
+        e.w = static_cast<uint16_t>(img.surface->w);
+        e.h = static_cast<uint16_t>(img.surface->h);
+        std::strncpy(e.name, img.name.c_str(), sizeof(e.name) - 1);
+        entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end(), [](const PackEntry &a, const PackEntry &b)
+              { return a.id < b.id; });
+    for (size_t i = 1; i < entries.size(); i++)
+    {
+        if (entries[i].id == entries[i - 1].id)
+        {
+            std::cout << "Asset ID collision between " << entries[i - 1].name << " and " << entries[i].name << std::endl;
+            return false;
+        }
+    }
+
+    PackHeader header{};
+    std::memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.pageCount = static_cast<uint32_t>(pages.size());
+    header.entryCount = static_cast<uint32_t>(entries.size());
+
+    std::vector<PackPage> pageTable;
+    uint64_t offset = sizeof(PackHeader) + pages.size() * sizeof(PackPage) + entries.size() * sizeof(PackEntry);
+    for (const Page &page : pages)
+    {
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        pageTable.push_back({static_cast<uint32_t>(page.width), static_cast<uint32_t>(page.height), offset});
+        offset += page.pixels.size();
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(pageTable.data()), pageTable.size() * sizeof(PackPage));
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(PackEntry));
+    for (size_t p = 0; p < pages.size(); p++)
+    {
+        const uint64_t padding = pageTable[p].offset - static_cast<uint64_t>(out.tellp());
+        const char zeros[PACK_ALIGNMENT] = {};
+        out.write(zeros, static_cast<std::streamsize>(padding));
+        out.write(reinterpret_cast<const char *>(pages[p].pixels.data()), pages[p].pixels.size());
+    }
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,126 @@
+// Converts the built in level arrays of levelData.h into the chunked level file the game streams.
+//
+// Usage: levelConverter <output level> [columns] [chunk columns]
+// Levels wider than the arrays repeat them, with the player only in the first copy, so very long
+// levels can be written to try streaming with. Chunks are written one at a time, memory use does not
+// grow with the width. Enemy markers go into the spawn table after the index instead of the cells.
+#include <SDL3/SDL.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdlib>
+
+#include "../levelFile.h"
+#include "../levelData.h"
+
+bool writeLevel(const char *path, int columns, int chunkColumns);
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: levelConverter <output level> [columns] [chunk columns]" << std::endl;
+        return 1;
+    }
+    const int columns = argc > 2 ? std::atoi(argv[2]) : MAP_COLUMNS;
+    const int chunkColumns = argc > 3 ? std::atoi(argv[3]) : 16;
+    if (columns <= 0 || chunkColumns <= 0)
+    {
+        std::cout << "Columns and chunk columns have to be positive" << std::endl;
+        return 1;
+    }
+
+    if (!writeLevel(argv[1], columns, chunkColumns))
+    {
+        std::cout << "Could not write " << argv[1] << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << columns << " columns in " << (columns + chunkColumns - 1) / chunkColumns
+              << " chunks to " << argv[1] << std::endl;
+    return 0;
+}
+
+uint64_t align(uint64_t offset)
+{
+    return (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+}
+
+/**
+ * @brief Writes header, index and chunks.
+ * @param path The level file to write.
+ * @param columns Width of the level in tiles.
+ * @param chunkColumns Width of a chunk in tiles.
+ * @return False if the file could not be written.
+ */
+bool writeLevel(const char *path, int columns, int chunkColumns)
+{
+    LevelHeader header = {};
+    std::copy(LEVEL_MAGIC, LEVEL_MAGIC + 4, header.magic);
+    header.version = LEVEL_VERSION;
+    header.rows = MAP_ROWS;
+    header.columns = columns;
+    header.chunkColumns = chunkColumns;
+    header.chunkCount = (columns + chunkColumns - 1) / chunkColumns;
+    header.spawnRow = header.spawnColumn = -1;
+    for (int r = 0; r < MAP_ROWS; r++)
+    {
+        for (int c = 0; c < std::min(columns, MAP_COLUMNS); c++)
+        {
+            if (LEVEL_MAP[r][c] == TILE_PLAYER)
+            {
+                header.spawnRow = r;
+                header.spawnColumn = c;
+            }
+        }
+    }
+    std::vector<LevelSpawn> enemies;
+    for (int c = 0; c < columns; c++)
+    {
+        for (int r = 0; r < MAP_ROWS; r++)
+        {
+            if (builtInTile(TileLayer::level, r, c) == TILE_ENEMY)
+            {
+                enemies.push_back({.row = r, .column = c});
+            }
+        }
+    }
+    header.enemyCount = static_cast<uint32_t>(enemies.size());
+
+    const uint32_t chunkSize = TILE_LAYER_COUNT * chunkColumns * MAP_ROWS;
+    const uint64_t dataStart = align(sizeof(LevelHeader) + header.chunkCount * sizeof(LevelChunk) +
+                                     enemies.size() * sizeof(LevelSpawn));
+    std::vector<LevelChunk> index(header.chunkCount);
+    for (uint32_t i = 0; i < header.chunkCount; i++)
+    {
+        index[i] = {.offset = dataStart + i * align(chunkSize), .size = chunkSize, .reserved = 0};
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(LevelChunk));
+    out.write(reinterpret_cast<const char *>(enemies.data()), enemies.size() * sizeof(LevelSpawn));
+
+    std::vector<uint8_t> cells(align(chunkSize));
+    for (uint32_t i = 0; i < header.chunkCount; i++)
+    {
+        out.seekp(index[i].offset);
+        std::fill(cells.begin(), cells.end(), 0);
+        for (size_t layer = 0; layer < TILE_LAYER_COUNT; layer++)
+        {
+            for (int local = 0; local < chunkColumns; local++)
+            {
+                const int c = i * chunkColumns + local;
+                for (int r = 0; r < MAP_ROWS && c < columns; r++)
+                {
+                    const uint8_t id = builtInTile(static_cast<TileLayer>(layer), r, c);
+                    if (id != TILE_PLAYER && id != TILE_ENEMY)
+                    {
+                        cells[(layer * chunkColumns + local) * MAP_ROWS + r] = id;
+                    }
+                }
+            }
+        }
+        out.write(reinterpret_cast<const char *>(cells.data()), cells.size());
+    }
+    return static_cast<bool>(out);
+}